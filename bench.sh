@@ -0,0 +1,12 @@
+#!/bin/sh
+# See LICENSE file for copyright and license details.
+#
+# Runs dwmbench against the dwm in this directory on a private Xvfb
+# display.  Arguments are passed on to dwmbench, BENCHDISPLAY picks the
+# display number.
+display=${BENCHDISPLAY:-:99}
+
+Xvfb $display -screen 0 1280x1024x24 -nolisten tcp >/dev/null 2>&1 &
+xvfb=$!
+trap 'kill $xvfb 2>/dev/null' EXIT INT TERM
+DISPLAY=$display ./dwmbench "$@" ./dwm
@@ -12,6 +12,23 @@ static const unsigned int borderpx  = 1;        /* border pixel of windows */
 static const unsigned int snap      = 32;       /* snap pixel */
 static const int showbar           = true;     /* false means no bar */
 static const int topbar            = true;     /* false means bottom bar */
+static const unsigned int titledelay = 250;     /* min ms between title refreshes */
+static const int hideunmap         = false;    /* true means unmap hidden clients instead of moving them off-screen */
+static const unsigned int maxroundtrips = 0;    /* log handlers waiting for more replies, 0 means never */
+static const char tracefile[]       = "/tmp/dwm.trace"; /* SIGUSR2 writes the event trace to tracefile.<pid> */
+static const char ipcsocket[]       = "dwm.sock"; /* IPC socket in XDG_RUNTIME_DIR, DISPLAY is appended, "" disables */
+static const char statusfifo[]      = "dwm.status"; /* status FIFO in XDG_RUNTIME_DIR, DISPLAY is appended, "" disables */
+
+/* status modules, shown right of the root window name; NULL disables an entry */
+static const char modulesep[]       = " | ";
+static const Module modules[] = {
+	/* function     interval (ms)  argument */
+	{ modnet,       2000,          "eth0" },
+	{ modmem,       5000,          NULL },
+	{ modload,      5000,          NULL },
+	{ modbattery,   30000,         "BAT0" },
+	{ modclock,     1000,          "%a %d %b %H:%M:%S" },
+};
 
 /* tagging */
 static const char *tags[] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
@@ -55,10 +72,15 @@ static const Layout layouts[] = {
 // static const char *dmenucmd[] = { "dmenu_run", "-fn", font, "-nb", normbgcolor, "-nf", normfgcolor, "-sb", selbgcolor, "-sf", selfgcolor, NULL };
 static const char *termcmd[]  = { "uxterm", NULL };
 
+/* scratchpad, recognized by its WM_CLASS instance */
+static const char scratchpadname[] = "scratchpad";
+static const char *scratchpadcmd[] = { "uxterm", "-name", scratchpadname, "-geometry", "100x30", NULL };
+
 static Key keys[] = {
 	/* modifier                     key        function        argument */
 	{ MODKEY,                       XK_p,      spawn,          {.v = dmenucmd } },
 	{ MODKEY|XCB_MOD_MASK_SHIFT,    XK_Return, spawn,          {.v = termcmd } },
+	{ MODKEY,                       XK_grave,  togglescratch,  {0} },
 	{ MODKEY,                       XK_b,      togglebar,      {0} },
 	{ MODKEY,                       XK_j,      focusstack,     {.i = +1 } },
 	{ MODKEY,                       XK_k,      focusstack,     {.i = -1 } },
@@ -94,6 +116,28 @@ static Key keys[] = {
 	{ MODKEY|XCB_MOD_MASK_SHIFT,             XK_q,      quit,           {0} },
 };
 
+/* IPC commands, see the IPC section of dwm(1) */
+static Command commands[] = {
+	/* name             function        argument */
+	{ "view",           view,           CmdTag },
+	{ "toggleview",     toggleview,     CmdTag },
+	{ "tag",            tag,            CmdTag },
+	{ "toggletag",      toggletag,      CmdTag },
+	{ "setlayout",      setlayout,      CmdLayout },
+	{ "setmfact",       setmfact,       CmdFloat },
+	{ "focusstack",     focusstack,     CmdInt },
+	{ "focusmon",       focusmon,       CmdInt },
+	{ "tagmon",         tagmon,         CmdInt },
+	{ "zoom",           zoom,           CmdNone },
+	{ "killclient",     killclient,     CmdNone },
+	{ "togglefloating", togglefloating, CmdNone },
+	{ "togglebar",      togglebar,      CmdNone },
+	{ "togglescratch",  togglescratch,  CmdNone },
+	{ "viewprev",       viewprev,       CmdNone },
+	{ "viewnext",       viewnext,       CmdNone },
+	{ "quit",           quit,           CmdNone },
+};
+
 /* button definitions */
 /* click can be ClkLtSymbol, ClkStatusText, ClkWinTitle, ClkClientWin, or ClkRootWin */
 static Button buttons[] = {
@@ -14,12 +14,19 @@ X11LIB = /usr/X11R6/lib
 XINERAMALIBS = -L${X11LIB} -lxcb-xinerama
 XINERAMAFLAGS = -DXINERAMA
 
+# RandR 1.2, comment if you don't want it
+XRANDRLIBS = -lxcb-randr
+XRANDRFLAGS = -DXRANDR
+
 # includes and libs
 INCS = -I. -I/usr/include -I${X11INC}
-LIBS = -L/usr/lib -L${X11LIB} -lxcb-icccm -lxcb-keysyms ${XINERAMALIBS} -lxcb -lm -lc
+LIBS = -L/usr/lib -L${X11LIB} -lxcb-icccm -lxcb-keysyms ${XINERAMALIBS} ${XRANDRLIBS} -lxcb -lm -lc
+
+# benchmark load generator, see bench.sh
+BENCHLIBS = -L/usr/lib -L${X11LIB} -lxcb-keysyms -lxcb-xtest -lxcb
 
 # flags
-CPPFLAGS = -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS}
+CPPFLAGS = -D_POSIX_C_SOURCE=200809L -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS} ${XRANDRFLAGS}
 #CFLAGS = -g -std=c99 -pedantic -Wall -O0 ${INCS} ${CPPFLAGS}
 CFLAGS = -std=c99 -pedantic -Wall -Os ${INCS} ${CPPFLAGS}
 #LDFLAGS = -g ${LIBS}
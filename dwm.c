@@ -20,29 +20,53 @@
  *
  * To understand everything else, start reading main().
  */
+#define _GNU_SOURCE /* POSIX_SPAWN_SETSID of glibc, see spawn() */
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <math.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
 #ifdef XINERAMA
 #include <xcb/xinerama.h>
 #endif /* XINERAMA */
+#ifdef XRANDR
+#include <xcb/randr.h>
+#endif /* XRANDR */
 
 #include <xcb/xcb.h>
 #include <xcb/xcb_event.h>
 #include <xcb/xcb_icccm.h>
 #include <xcb/xcb_keysyms.h>
 
+#include "layout.h"
+#include "trace.h"
+
 /* macros */
 #define BUTTONMASK              (XCB_EVENT_MASK_BUTTON_PRESS|XCB_EVENT_MASK_BUTTON_RELEASE)
 #define CLEANMASK(mask)         (mask & ~(XCB_MOD_MASK_LOCK|numlockmask))
+#define FLUSH()                 (stats.flushes++, xcb_flush(xcb_dpy))
+#define REPLY(F, ...)           replyend(__func__, __LINE__, (replybegin(), F(__VA_ARGS__)))
+#define REPLYOK(F, ...)         replyok(__func__, __LINE__, (replybegin(), F(__VA_ARGS__)))
+#define SW(S)                   ((S)->xs->width_in_pixels)
+#define SH(S)                   ((S)->xs->height_in_pixels)
 #define INRECT(X,Y,RX,RY,RW,RH) ((X) >= (RX) && (X) < (RX) + (RW) && (Y) >= (RY) && (Y) < (RY) + (RH))
 #define ISVISIBLE(C)            ((C->tags & C->mon->tagset[C->mon->seltags]))
 #define LENGTH(X)               (sizeof X / sizeof X[0])
@@ -52,20 +76,34 @@
 #define WIDTH(X)                ((X)->w + 2 * (X)->bw)
 #define HEIGHT(X)               ((X)->h + 2 * (X)->bw)
 #define TAGMASK                 ((1 << LENGTH(tags)) - 1)
+#define SPTAG                   (1 << LENGTH(tags)) /* the scratchpad, no tagset has it */
 #define TEXTW(X)                (textnw(X, strlen(X)) + dc.font.height)
 
 #define true 1
 #define false 0
 
+#define IPCMAXOUT               65536 /* replies queued before a client is dropped */
+#define IPCLOWAT                4096 /* queued bytes below which updates are sent */
+#define LATBUCKETS              24  /* log2 microsecond histogram buckets */
+#define LAUNCHCMDS              16  /* commands with launch statistics */
+#define LAUNCHES                32  /* spawned pids awaiting their window */
+#define REPLYSITES              64  /* call sites tracked by REPLY() */
+#define TIMERS                  16  /* pending settimer() requests */
+#define WATCHES                 64  /* fds polled by run() besides X */
 #define XCB_CONFIG_MOVERESIZE   (XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT)
 
 /* enums */
 enum { CurNormal, CurResize, CurMove, CurLast };        /* cursor */
 enum { ColBorder, ColFG, ColBG, ColLast };              /* color */
-enum { NetSupported, NetWMName, NetLast };              /* EWMH atoms */
+enum { NetSupported, NetWMName, NetWMPid, NetClientList, NetClientListStacking,
+       NetActiveWindow, NetCurrentDesktop, NetNumberOfDesktops, NetLast }; /* EWMH atoms */
+enum { EwmhClients, EwmhStacking, EwmhActive, EwmhDesktop };      /* see updateewmh() */
 enum { WMProtocols, WMDelete, WMState, WMLast };        /* default atoms */
 enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast };             /* clicks */
+enum { CmdNone, CmdInt, CmdFloat, CmdTag, CmdLayout };  /* IPC arguments */
+enum { SubMonitor, SubTags, SubLayout, SubFocus, SubTitle,
+       SubLast };                                       /* IPC subscriptions */
 
 typedef union {
   int i;
@@ -86,14 +124,31 @@ typedef struct Monitor Monitor;
 typedef struct Client Client;
 struct Client {
   char name[256];
-  float mina, maxa;
   int16_t x, y;
   uint16_t w, h;
-  int32_t basew, baseh, incw, inch, maxw, maxh, minw, minh;
+  Hints hints;
   uint16_t bw;
   uint32_t oldbw;
   unsigned int tags;
   int isfixed, isfloating, isurgent;
+  int ishidden;             /* hidden by showhide() */
+  int ignoreunmap;          /* pending UnmapNotify caused by showhide() */
+  int titledirty;           /* name changed but not fetched yet */
+  uint64_t titletime;       /* last time the name was fetched */
+  uint64_t launched;        /* spawn() time while the first focus is pending */
+  unsigned int launchcmd;   /* its command in stats.launch */
+  struct {
+    int16_t x, y;
+    uint16_t w, h, bw;
+  } srv;                    /* geometry last sent to the server */
+  unsigned long stackgen;   /* restack() which last placed the window */
+  unsigned int stackpos;    /* position among the tiled windows then */
+  struct {
+    char mon[32];           /* output name, empty if not displaced */
+    unsigned int tags;
+    int16_t x, y;           /* relative to the output */
+    uint16_t w, h;
+  } home;                   /* placement before removemon(), see restoreclients() */
   Client *next;
   Client *snext;
   Monitor *mon;
@@ -103,8 +158,8 @@ struct Client {
 typedef struct {
   int16_t x, y;
   uint16_t w, h;
-  uint32_t norm[ColLast];
-  uint32_t sel[ColLast];
+  uint32_t *norm;           /* colors of the screen drawn on */
+  uint32_t *sel;
   xcb_drawable_t drawable;
   xcb_gcontext_t gc;
   struct {
@@ -113,9 +168,24 @@ typedef struct {
     uint16_t height;
     // XFontSet set;
     xcb_font_t xfont;
+    int16_t width[256];     /* advance of each character, see textnw() */
   } font;
 } DC; /* draw context */
 
+typedef struct {
+  xcb_screen_t *xs;
+  xcb_window_t root;
+  xcb_gcontext_t gc;
+  uint32_t norm[ColLast];
+  uint32_t sel[ColLast];
+  struct {
+    int x, y, w, h;     /* area covered by the monitor edges */
+    uint16_t *col, *row; /* pixel to grid column/row, see ptrtomon() */
+    unsigned int ncols;
+    Monitor **cell;     /* monitor of each grid cell, NULL for gaps */
+  } grid;
+} Screen;
+
 typedef struct {
   uint16_t mod;
   xcb_keysym_t keysym;
@@ -128,16 +198,70 @@ typedef struct {
   void (*arrange)(Monitor *);
 } Layout;
 
+typedef struct {
+  const char *name;
+  void (*func)(const Arg *);
+  unsigned int argtype;
+} Command;
+
+typedef struct {
+  char text[64];
+  uint64_t due;             /* monotonic us of the next run */
+  uint64_t prev[2], prevtime; /* for modules reporting rates */
+} ModuleState;
+
+typedef struct {
+  void (*func)(ModuleState *s, const char *arg);
+  unsigned int interval;    /* ms */
+  const char *arg;
+} Module;
+
+typedef struct IpcConn IpcConn;
+struct IpcConn {
+  int fd;
+  int dead;                 /* close once the current request is done */
+  char in[512];             /* partial request line */
+  unsigned int inlen;
+  char *out;                /* replies the socket did not take yet */
+  size_t outlen, outsize;
+  unsigned int subscribed;  /* 1 << Sub* streams asked for */
+  unsigned int pending;     /* streams changed since last sent */
+  IpcConn *next;
+};
+
+typedef struct {
+  int fd;
+  short events;
+  void (*func)(int fd, short revents);
+} Watch;
+
+typedef struct {
+  unsigned long count;
+  uint64_t total, max;      /* us */
+  unsigned long hist[LATBUCKETS]; /* bucket i < 2^i us, see latbucket() */
+} Latency;
+
+typedef struct {
+  uint64_t due;             /* monotonic us, 0 if not pending */
+  void (*func)(void);
+} Timer;
+
 struct Monitor {
   char ltsymbol[16];
+  char name[32];            /* RandR output name */
   float mfact;
   int num;
+  unsigned int pos;         /* index in monv, physical order */
+  int dirty;                /* geometry changed, see updatemons() */
+  uint32_t crtc;            /* RandR CRTC showing the monitor */
   int16_t by;               /* bar geometry */
   int16_t mx, my, mw, mh;   /* screen size */
   int16_t wx, wy, ww, wh;   /* window area  */
+  Screen *scr;              /* X screen holding the monitor */
   unsigned int seltags;
   unsigned int sellt;
   unsigned int tagset[2];
+  unsigned long stackgen;   /* last restack() of the tiled windows */
   int showbar;
   int topbar;
   Client *clients;
@@ -145,6 +269,8 @@ struct Monitor {
   Client *stack;
   Monitor *next;
   xcb_window_t barwin;
+  xcb_pixmap_t barpix;      /* bar render target, barpixw wide */
+  uint16_t barpixw;
   const Layout *lt[2];
 };
 
@@ -160,10 +286,12 @@ typedef struct {
 /* function declarations */
 static void applyrules(Client *c);
 static int applysizehints(Client *c, int16_t *x, int16_t *y, uint16_t *w, uint16_t *h, int interact);
+static void armtimer(void);
 static void arrange(Monitor *m);
 static void arrangemon(Monitor *m);
 static void attach(Client *c);
 static void attachstack(Client *c);
+static void buildstatus(void);
 static int buttonpress(void *dummy, xcb_connection_t *dpy, xcb_button_press_event_t *e);
 static void checkotherwm(void);
 static void cleanup(void);
@@ -181,67 +309,128 @@ static Monitor *dirtomon(int dir);
 static void drawbar(Monitor *m);
 static void drawbars(void);
 static void drawsquare(int filled, int empty, int invert, uint32_t col[ColLast]);
+static void drawstatus(void);
 static void drawtext(const char *text, uint32_t col[ColLast], int invert);
+static void dumptrace(void);
 static int enternotify(void *dummy, xcb_connection_t *dpy, xcb_enter_notify_event_t *e);
 static int expose(void *dummy, xcb_connection_t *dpy, xcb_expose_event_t *e);
 static void focus(Client *c);
 static int focusin(void *dummy, xcb_connection_t *dpy, xcb_focus_in_event_t *e);
 static void focusmon(const Arg *arg);
 static void focusstack(const Arg *arg);
-static uint32_t getcolor(const uint16_t rgb[]);
-static int getrootptr(int16_t *x, int16_t *y);
+static uint32_t getcolor(xcb_colormap_t cmap, const uint16_t rgb[]);
+static int getrootptr(xcb_window_t root, int16_t *x, int16_t *y);
 // static long getstate(Window w);
 static int gettextprop(xcb_window_t w, xcb_atom_t atom, char *text, unsigned int size);
 static void grabbuttons(Client *c, int focused);
 static void grabkeys(void);
+static void indexmons(void);
+static int intcmp(const void *a, const void *b);
 static void initfont(const char *fontstr);
+static void ipcaccept(int fd, short revents);
+static void ipcclose(IpcConn *ic);
+static void ipccommand(IpcConn *ic, char *line);
+static void ipcflush(IpcConn *ic);
+static void ipcio(int fd, short revents);
+static void ipcprintf(IpcConn *ic, const char *fmt, ...);
+static void ipcsetup(void);
+static void ipcsubscribe(IpcConn *ic, char *streams);
 static int isprotodel(const Client *c);
 static int keypress(void *dummy, xcb_connection_t *dpy, xcb_key_press_event_t *e);
 static void killclient(const Arg *arg);
+static void latadd(Latency *l, uint64_t us);
+static unsigned int latbucket(uint64_t us);
+static void latprint(const char *what, const Latency *l);
+static void launchmapped(Client *c, uint32_t pid);
 static void manage(xcb_window_t w, xcb_get_window_attributes_reply_t *wa,
 		   xcb_get_geometry_cookie_t cookie_g);
 static int mappingnotify(void *dummy, xcb_connection_t *dpy, xcb_mapping_notify_event_t *e);
 static int maprequest(void *dummy, xcb_connection_t *dpy, xcb_map_request_event_t *e);
+static int monposcmp(const void *a, const void *b);
 static void monocle(Monitor *m);
+static void modbattery(ModuleState *s, const char *arg);
+static void modclock(ModuleState *s, const char *arg);
+static void modload(ModuleState *s, const char *arg);
+static void modmem(ModuleState *s, const char *arg);
+static void modnet(ModuleState *s, const char *arg);
+static void modulessetup(void);
 static void movemouse(const Arg *arg);
+static void notify(unsigned int streams);
 static Client *nexttiled(Client *c);
-static Monitor *ptrtomon(int x, int y);
+static uint64_t now(void);
+static Monitor *pointermon(void);
+static const char *evname(uint8_t type);
+static xcb_window_t evwindow(xcb_generic_event_t *e);
+static void printstats(void);
+static Monitor *ptrtomon(Screen *s, int x, int y);
 static int propertynotify(void *dummy, xcb_connection_t *dpy, xcb_property_notify_event_t *e);
+static void publish(void);
 static void quit(const Arg *arg);
+static int readfile(const char *path, char *buf, size_t size);
+static void record(xcb_generic_event_t *e, uint64_t t);
+static void recordevent(xcb_generic_event_t *e, uint64_t start, uint64_t t,
+			unsigned long rt, unsigned long fl, unsigned int rq);
+#ifdef XRANDR
+static int randrnotify(void *dummy, xcb_connection_t *dpy, xcb_generic_event_t *e);
+#endif /* XRANDR */
+static void removemon(Monitor *m, Monitor *to);
+static void replybegin(void);
+static void *replyend(const char *func, int line, void *r);
+static int replyok(const char *func, int line, int ok);
 static void resize(Client *c, int16_t x, int16_t y, uint16_t w, uint16_t h, int interact);
+static void resizeclient(Client *c, const Rect *r);
 static void resizemouse(const Arg *arg);
 static void restack(Monitor *m);
+static int restoreclients(void);
+static Screen *roottoscreen(xcb_window_t w);
 static void run(void);
-static void scan(void);
+static void runmodules(void);
+static int runtimepath(char *path, size_t size, const char *name);
+static void scan(xcb_window_t root);
+static int sendgeom(Client *c, int16_t x, int16_t y);
 static void sendmon(Client *c, Monitor *m);
 static void setclientstate(Client *c, xcb_wm_state_t state);
 static void setlayout(const Arg *arg);
 static void setmfact(const Arg *arg);
 static void setup(void);
-static void showhide(Client *c);
-static void sigchld(int unused);
+static void setstatus(const char *text);
+static void showhide(Monitor *m);
+static void settimer(void (*func)(void), uint64_t due);
+static void sigread(int fd, short revents);
 static void spawn(const Arg *arg);
+static pid_t spawnpid(const Arg *arg);
+static void statusread(int fd, short revents);
+static void statussetup(void);
 static void tag(const Arg *arg);
 static void tagmon(const Arg *arg);
 static int textnw(const char *text, unsigned int len);
 static void tile(Monitor *);
+static void timerexpired(int fd, short revents);
+static Geom *tiledgeoms(Monitor *m, unsigned int *n);
+static void tileplace(Monitor *m, const Geom *g);
 static void togglebar(const Arg *arg);
 static void togglefloating(const Arg *arg);
+static void togglescratch(const Arg *arg);
 static void toggletag(const Arg *arg);
 static void toggleview(const Arg *arg);
 static void unfocus(Client *c);
+static void unwatchfd(int fd);
 static void unmanage(Client *c, int destroyed);
 static int unmapnotify(void *dummy, xcb_connection_t *dpy, xcb_unmap_notify_event_t *e);
 static int updategeom(void);
 static void updatebarpos(Monitor *m);
 static void updatebars(void);
+static void updateewmh(void);
+static void updatemons(void);
 static void updatenumlockmask(void);
 static void updatesizehints(Client *c);
 static void updatestatus(void);
 static void updatetitle(Client *c);
+static void updatetitles(void);
 static void updatewmhints(Client *c);
 static void view(const Arg *arg);
 static void viewnext(const Arg *arg);
+static void watchfd(int fd, short events, void (*func)(int fd, short revents));
 static void viewprev(const Arg *arg);
 static Client *wintoclient(xcb_window_t w);
 static Monitor *wintomon(xcb_window_t w);
@@ -251,12 +440,16 @@ static void xcb_error_print(void);
 static void zoom(const Arg *arg);
 
 /* variables */
+extern char **environ;
 static const char broken[] = "broken";
-static char stext[256];
-static xcb_screen_t *screen;  /* X display screen structure */
-/* X display screen geometry width, height */
-#define sw (screen->width_in_pixels)
-#define sh (screen->height_in_pixels)
+static char stext[1024];
+static uint16_t statusw = 0; /* width of the status drawn last, 0 if clipped */
+static char extstatus[sizeof stext]; /* from the root window name or the FIFO */
+static int hasmodules = false;
+static int statusfd[2] = { -1, -1 }; /* status FIFO, read and keep-alive ends */
+static char statuspath[108];
+static Screen *screens;
+static int nscreens, defscreen = 0; /* defscreen holds the status text */
 static uint16_t bh, blw = 0;      /* bar geometry */
 // static int (*xerrorxlib)(Display *, XErrorEvent *);
 static uint16_t numlockmask = 0;
@@ -264,19 +457,87 @@ static xcb_event_handlers_t evenths;
 static xcb_key_symbols_t *keysyms = 0;
 static xcb_atom_t wmatom[WMLast], netatom[NetLast];
 static int running = true;
+static unsigned long restacks = 0;
+static FILE *recfile = NULL;  /* dwm -r, see record() */
+static int countreqs = false; /* dwm -t, trace the requests of each event */
+static uint64_t recstart;
+static struct {
+  TraceEntry e[TRACELEN];
+  unsigned long n;                       /* events recorded so far */
+  unsigned int lastseq;                  /* sequence of the last request accounted */
+} trace;
+static struct {
+  unsigned long restacked, restacksaved; /* stacking requests sent/avoided */
+  unsigned long roundtrips, flushes;     /* see REPLY() and FLUSH() */
+  uint64_t replystart;                   /* pending reply wait, see replybegin() */
+  struct {
+    const char *func;
+    int line;
+    unsigned long count;
+    uint64_t wait;                       /* time blocked in us */
+  } site[REPLYSITES];                    /* by source line */
+  struct {
+    unsigned long count, roundtrips, flushes;
+    uint64_t total, max;                 /* handler time in us */
+    unsigned long hist[LATBUCKETS];      /* handler time, bucket i < 2^i us */
+  } ev[128];                             /* by response type */
+  Latency spawn;                         /* spawn() to exec */
+  unsigned long spawnfailed;
+  struct {
+    const char *const *cmd;              /* Arg.v of spawn(), NULL if free */
+    Latency map, focus;                  /* spawn() to MapRequest, to focus() */
+  } launch[LAUNCHCMDS];
+} stats;
+static struct {
+  pid_t pid;
+  unsigned int cmd;                      /* in stats.launch */
+  uint64_t time;                         /* spawn() time, 0 if free */
+} launches[LAUNCHES];                    /* see launchmapped() */
 static xcb_cursor_t cursor[CurLast];
 // static Display *dpy;
 static xcb_connection_t *xcb_dpy;
 static xcb_generic_error_t *xerr;
 static DC dc;
 static Monitor *mons = NULL, *selmon = NULL;
-static xcb_window_t root;
+static int geomstale = false; /* outputs changed, updategeom() is pending */
+static int scratchshow = false; /* show the scratchpad once it is managed */
+static pid_t scratchpid = 0; /* its launch which has not mapped yet */
+static struct {
+  xcb_window_t win;
+  Screen *scr;
+} *clientlist = NULL;       /* managed windows, oldest first */
+static unsigned int nclientlist = 0, clientlistsize = 0;
+static unsigned int clientlistsent = 0; /* entries on the root windows */
+static unsigned int ewmhdirty = ~0U; /* EWMH root properties to update */
+static Monitor **monv = NULL; /* monitors by screen, then by x, then by y */
+static unsigned int nmons = 0;
+static Geom *geoms = NULL; /* scratch for the layout functions, see tiledgeoms() */
+static unsigned int ngeoms = 0;
+static int epfd = -1;       /* epoll instance of run() */
+static int sigfd = -1;      /* signalfd of the signals dwm handles */
+static int timerfd = -1;    /* armed for the earliest of timers[] */
+static uint64_t timerarmed = 0;
+static Timer timers[TIMERS];
+static Watch watches[WATCHES];
+static unsigned int nwatches = 0;
+static int ipcfd = -1;
+static char ipcpath[108];   /* bound IPC socket, see ipcsetup() */
+static IpcConn *ipcconns = NULL;
+static const char *subnames[SubLast] = {
+  [SubMonitor] = "monitor", [SubTags] = "tags", [SubLayout] = "layout",
+  [SubFocus] = "focus", [SubTitle] = "title",
+};
+#ifdef XRANDR
+static int randrbase = -1, randrminor;
+#endif /* XRANDR */
 
 /* configuration, allows nested code to access above variables */
 #include "config.h"
 
-/* compile-time check if all tags fit into an unsigned int bit array. */
-struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
+/* compile-time check if all tags and SPTAG fit into an unsigned int bit array. */
+struct NumTags { char limitexceeded[LENGTH(tags) > 30 ? -1 : 1]; };
+
+static ModuleState modstate[LENGTH(modules)];
 
 /* convenience wrapper */
 void xcb_raise_window(xcb_connection_t *conn, xcb_window_t w) {
@@ -289,6 +550,7 @@ void
 applyrules(Client *c) {
   const char *class, *instance;
   unsigned int i;
+  int scratch;
   const Rule *r;
   Monitor *m;
   xcb_get_property_cookie_t cookie;
@@ -296,9 +558,10 @@ applyrules(Client *c) {
 
   /* rule matching */
   c->isfloating = c->tags = 0;
+  scratch = false;
 
   cookie = xcb_get_wm_class(xcb_dpy, c->win);
-  int ok = xcb_get_wm_class_reply(xcb_dpy, cookie, &ch, &xerr);
+  int ok = REPLYOK(xcb_get_wm_class_reply, xcb_dpy, cookie, &ch, &xerr);
   if (!ok) {
     xcb_error_print();
   }
@@ -318,99 +581,88 @@ applyrules(Client *c) {
 	    c->mon = m;
 	}
     }
+    scratch = !strcmp(instance, scratchpadname);
     xcb_get_wm_class_reply_wipe(&ch);
   }
 
-  c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
+  if(scratch) { /* shown where togglescratch() was used */
+    c->isfloating = true;
+    c->mon = selmon;
+    c->tags = SPTAG | (scratchshow ? c->mon->tagset[c->mon->seltags] : 0);
+    scratchshow = false;
+    scratchpid = 0;
+  }
+  else
+    c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
 }
 
 int
 applysizehints(Client *c, int16_t *x, int16_t *y,
 	       uint16_t *w, uint16_t *h, const int interact) {
   Monitor *m = c->mon;
+  Rect r = { *x, *y, *w, *h }, cur = { c->x, c->y, c->w, c->h }, area;
 
-  /* set minimum possible */
-  *w = MAX(1, *w);
-  *h = MAX(1, *h);
   if(interact) {
-    if(*x > sw)
-      *x = sw - WIDTH(c);
-    if(*y > sh)
-      *y = sh - HEIGHT(c);
-    if(*x + *w + 2 * c->bw < 0)
-      *x = 0;
-    if(*y + *h + 2 * c->bw < 0)
-      *y = 0;
+    area.x = area.y = 0;
+    area.w = SW(m->scr);
+    area.h = SH(m->scr);
   }
   else {
-    if(*x > m->mx + m->mw)
-      *x = m->mx + m->mw - WIDTH(c);
-    if(*y > m->my + m->mh)
-      *y = m->my + m->mh - HEIGHT(c);
-    if(*x + *w + 2 * c->bw < m->mx)
-      *x = m->mx;
-    if(*y + *h + 2 * c->bw < m->my)
-      *y = m->my;
-  }
-  if(*h < bh)
-    *h = bh;
-  if(*w < bh)
-    *w = bh;
-  if(resizehints || c->isfloating) {
-    /* see last two sentences in ICCCM 4.1.2.3 */
-    int baseismin = c->basew == c->minw && c->baseh == c->minh;
-    if(!baseismin) { /* temporarily remove base dimensions */
-      *w -= c->basew;
-      *h -= c->baseh;
-    }
-    /* adjust for aspect limits */
-    if(c->mina > 0 && c->maxa > 0) {
-      if(c->maxa < (float)*w / *h)
-	*w = lroundf(*h * c->maxa);
-      else if(c->mina < (float)*h / *w)
-	*h = lroundf(*w * c->mina);
-    }
-    if(baseismin) { /* increment calculation requires this */
-      *w -= c->basew;
-      *h -= c->baseh;
-    }
-    /* adjust for increment value */
-    if(c->incw)
-      *w -= *w % c->incw;
-    if(c->inch)
-      *h -= *h % c->inch;
-    /* restore base dimensions */
-    *w += c->basew;
-    *h += c->baseh;
-    *w = MAX(*w, c->minw);
-    *h = MAX(*h, c->minh);
-    if(c->maxw)
-      *w = MIN(*w, c->maxw);
-    if(c->maxh)
-      *h = MIN(*h, c->maxh);
+    area.x = m->mx;
+    area.y = m->my;
+    area.w = m->mw;
+    area.h = m->mh;
   }
+  layoutclamp(&r, &cur, c->bw, &area);
+  layouthints(&r, &c->hints, bh, resizehints || c->isfloating);
+  *x = r.x;
+  *y = r.y;
+  *w = r.w;
+  *h = r.h;
   return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
 }
 
+/* Arms the timerfd for the earliest pending timer. */
+void
+armtimer(void) {
+  struct itimerspec its;
+  uint64_t next = 0;
+  unsigned int i;
+
+  for(i = 0; i < LENGTH(timers); i++)
+    if(timers[i].due && (!next || timers[i].due < next))
+      next = timers[i].due;
+  if(next == timerarmed)
+    return;
+  timerarmed = next;
+  memset(&its, 0, sizeof its); /* all zero disarms */
+  its.it_value.tv_sec = next / 1000000;
+  its.it_value.tv_nsec = next % 1000000 * 1000;
+  timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
 void
 arrange(Monitor *m) {
   if(m)
-    showhide(m->stack);
+    arrangemon(m);
   else for(m = mons; m; m = m->next)
-	 showhide(m->stack);
+	 arrangemon(m);
   focus(NULL);
   if(m)
-    arrangemon(m);
+    restack(m);
   else for(m = mons; m; m = m->next)
-	 arrangemon(m);
+	 restack(m);
+  notify(1 << SubTags | 1 << SubLayout);
 }
 
+/* The layout runs before showhide(), so that clients which become visible
+ * are configured once with their final geometry. */
 void
 arrangemon(Monitor *m) {
   strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
   if(m->lt[m->sellt]->arrange)
     m->lt[m->sellt]->arrange(m);
-  restack(m);
+  showhide(m);
 }
 
 void
@@ -425,6 +677,23 @@ attachstack(Client *c) {
   c->mon->stack = c;
 }
 
+/* Puts the external status and the module texts together in stext. */
+void
+buildstatus(void) {
+  char buf[sizeof stext];
+  unsigned int i;
+  int n;
+
+  n = snprintf(buf, sizeof buf, "%s", extstatus);
+  for(i = 0; i < LENGTH(modules); i++)
+    if(modules[i].func && modstate[i].text[0] && n < sizeof buf)
+      n += snprintf(buf + n, sizeof buf - n, "%s%s", n ? modulesep : "", modstate[i].text);
+  if(!strcmp(buf, stext))
+    return;
+  strcpy(stext, buf);
+  drawstatus();
+}
+
 int
 buttonpress(void *dummy, xcb_connection_t *dpy, xcb_button_press_event_t *ev) {
   unsigned int i, x, click;
@@ -470,11 +739,16 @@ void
 checkotherwm(void) {
   /* this causes an error if some other window manager is running */
   uint32_t mask = XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT;
-  xcb_void_cookie_t cookie = xcb_change_window_attributes_checked
-    (xcb_dpy, root, XCB_CW_EVENT_MASK, &mask);
-  xerr = xcb_request_check(xcb_dpy, cookie);
-  if(xerr)
-    die("dwm: another window manager is already running\n");
+  xcb_void_cookie_t cookie;
+  int i;
+
+  for(i = 0; i < nscreens; i++) {
+    cookie = xcb_change_window_attributes_checked
+      (xcb_dpy, screens[i].root, XCB_CW_EVENT_MASK, &mask);
+    xerr = REPLY(xcb_request_check, xcb_dpy, cookie);
+    if(xerr)
+      die("dwm: another window manager is already running\n");
+  }
 }
 
 void
@@ -482,6 +756,7 @@ cleanup(void) {
   Arg a = {.ui = ~0};
   Layout foo = { "", NULL };
   Monitor *m;
+  int i;
 
   view(&a);
   selmon->lt[selmon->sellt] = &foo;
@@ -492,16 +767,42 @@ cleanup(void) {
     XFreeFontSet(dpy, dc.font.set);
     else */
   xcb_close_font(xcb_dpy, dc.font.xfont);
-  xcb_ungrab_key(xcb_dpy, XCB_GRAB_ANY, root, XCB_MOD_MASK_ANY);
   xcb_key_symbols_free(keysyms);
-  xcb_free_pixmap(xcb_dpy, dc.drawable);
-  xcb_free_gc(xcb_dpy, dc.gc);
+  for(i = 0; i < nscreens; i++) {
+    xcb_ungrab_key(xcb_dpy, XCB_GRAB_ANY, screens[i].root, XCB_MOD_MASK_ANY);
+    xcb_free_gc(xcb_dpy, screens[i].gc);
+  }
   xcb_free_cursor(xcb_dpy, cursor[CurNormal]);
   xcb_free_cursor(xcb_dpy, cursor[CurResize]);
   xcb_free_cursor(xcb_dpy, cursor[CurMove]);
   while(mons)
     cleanupmon(mons);
-  xcb_flush(xcb_dpy);
+  if(recfile)
+    fclose(recfile);
+  free(monv);
+  free(geoms);
+  free(clientlist);
+  while(ipcconns)
+    ipcclose(ipcconns);
+  if(ipcfd != -1) {
+    close(ipcfd);
+    unlink(ipcpath);
+  }
+  close(timerfd);
+  close(sigfd);
+  close(epfd);
+  if(statuspath[0]) {
+    close(statusfd[0]);
+    close(statusfd[1]);
+    unlink(statuspath);
+  }
+  for(i = 0; i < nscreens; i++) {
+    free(screens[i].grid.col);
+    free(screens[i].grid.row);
+    free(screens[i].grid.cell);
+  }
+  free(screens);
+  FLUSH();
   xcb_set_input_focus(xcb_dpy, XCB_INPUT_FOCUS_POINTER_ROOT,
 		      XCB_INPUT_FOCUS_POINTER_ROOT, XCB_TIME_CURRENT_TIME);
 
@@ -519,6 +820,8 @@ cleanupmon(Monitor *mon) {
   }
   xcb_unmap_window(xcb_dpy, mon->barwin);
   xcb_destroy_window(xcb_dpy, mon->barwin);
+  if(mon->barpix)
+    xcb_free_pixmap(xcb_dpy, mon->barpix);
   free(mon);
 }
 
@@ -528,8 +831,9 @@ clearurgent(Client *c) {
   xcb_wm_hints_t       *hints = NULL;
 
   c->isurgent = false;
+  notify(1 << SubTags);
   cookie = xcb_get_wm_hints(xcb_dpy, c->win);
-  if(!(xcb_get_wm_hints_reply(xcb_dpy, cookie, hints, NULL)))
+  if(!(REPLYOK(xcb_get_wm_hints_reply, xcb_dpy, cookie, hints, NULL)))
     return;
   if (hints)
     {
@@ -558,23 +862,17 @@ configure(Client *c) {
 
 int
 configurenotify(void *dummy, xcb_connection_t *Xdpy, xcb_configure_notify_event_t *ev) {
-  Monitor *m;
-
-  if(ev->window == root) {
-    sw = ev->width;
-    sh = ev->height;
-    if(updategeom()) {
-      if(dc.drawable != 0)
-	xcb_free_pixmap(xcb_dpy, dc.drawable);
-      dc.drawable = xcb_generate_id(xcb_dpy);
-      xcb_create_pixmap(xcb_dpy, screen->root_depth, dc.drawable, root, sw, bh);
-      updatebars();
-      for(m = mons; m; m = m->next) {
-	uint32_t geometry[] = {m->wx, m->by, m->ww, bh};
-	xcb_configure_window(xcb_dpy, m->barwin, XCB_CONFIG_MOVERESIZE, geometry);
-      }
-      arrange(NULL);
-    }
+  Screen *s;
+
+  if((s = roottoscreen(ev->window))) {
+    SW(s) = ev->width;
+    SH(s) = ev->height;
+#ifdef XRANDR
+    if(randrbase >= 0)
+      return 1; /* monitors follow the RandR notifications */
+#endif /* XRANDR */
+    if(updategeom())
+      updatemons();
   }
 
   return 1;
@@ -605,10 +903,8 @@ configurerequest(void *dummy, xcb_connection_t *dpy, xcb_configure_request_event
       if((ev->value_mask & (XCB_CONFIG_WINDOW_X|XCB_CONFIG_WINDOW_Y))
 	 && !(ev->value_mask & (XCB_CONFIG_WINDOW_WIDTH|XCB_CONFIG_WINDOW_HEIGHT)))
 	configure(c);
-      if(ISVISIBLE(c)) {
-	uint32_t geom[] = { c->x, c->y, c->w, c->h };
-	xcb_configure_window(xcb_dpy, c->win, XCB_CONFIG_MOVERESIZE, geom);
-      }
+      if(ISVISIBLE(c))
+	sendgeom(c, c->x, c->y);
     }
     else
       configure(c);
@@ -619,7 +915,7 @@ configurerequest(void *dummy, xcb_connection_t *dpy, xcb_configure_request_event
 	ev->border_width, ev->sibling, ev->stack_mode };
     xcb_configure_window(xcb_dpy, ev->window, ev->value_mask, wc);
   }
-  xcb_flush(xcb_dpy);
+  FLUSH();
   return 1;
 }
 
@@ -633,6 +929,7 @@ createmon(void) {
   m->mfact = mfact;
   m->showbar = showbar;
   m->topbar = topbar;
+  m->scr = screens;
   m->lt[0] = &layouts[0];
   m->lt[1] = &layouts[1 % LENGTH(layouts)];
   strncpy(m->ltsymbol, layouts[0].symbol, sizeof m->ltsymbol);
@@ -680,19 +977,7 @@ die(const char *errstr, ...) {
 
 Monitor *
 dirtomon(int dir) {
-  Monitor *m = NULL;
-
-  if(dir > 0) {
-    if(!(m = selmon->next))
-      m = mons;
-  }
-  else {
-    if(selmon == mons)
-      for(m = mons; m->next; m = m->next);
-    else
-      for(m = mons; m->next != selmon; m = m->next);
-  }
-  return m;
+  return monv[(selmon->pos + (dir > 0 ? 1 : nmons - 1)) % nmons];
 }
 
 void
@@ -707,6 +992,10 @@ drawbar(Monitor *m) {
     if(c->isurgent)
       urg |= c->tags;
   }
+  dc.drawable = m->barpix;
+  dc.gc = m->scr->gc;
+  dc.norm = m->scr->norm;
+  dc.sel = m->scr->sel;
   dc.x = 0;
   for(i = 0; i < LENGTH(tags); i++) {
     dc.w = TEXTW(tags[i]);
@@ -721,11 +1010,12 @@ drawbar(Monitor *m) {
   dc.x += dc.w;
   x = dc.x;
   if(m == selmon) { /* status is only drawn on selected monitor */
-    dc.w = TEXTW(stext);
+    dc.w = statusw = TEXTW(stext);
     dc.x = m->ww - dc.w;
     if(dc.x < x) {
       dc.x = x;
       dc.w = m->ww - x;
+      statusw = 0;
     }
     drawtext(stext, dc.norm, false);
   }
@@ -743,7 +1033,7 @@ drawbar(Monitor *m) {
   }
   xcb_copy_area(xcb_dpy, dc.drawable, m->barwin, dc.gc,
 		0, 0, 0, 0, m->ww, bh);
-  xcb_flush(xcb_dpy);
+  FLUSH();
 }
 
 void
@@ -775,10 +1065,31 @@ drawsquare(int filled, int empty, int invert, uint32_t col[ColLast]) {
   }
 }
 
+/* Redraws the status text alone if its width did not change, the rest of
+ * the bar otherwise stays as drawbar() left it. */
+void
+drawstatus(void) {
+  Monitor *m = selmon;
+
+  if(!statusw || TEXTW(stext) != statusw) {
+    drawbar(m);
+    return;
+  }
+  dc.drawable = m->barpix;
+  dc.gc = m->scr->gc;
+  dc.norm = m->scr->norm;
+  dc.sel = m->scr->sel;
+  dc.w = statusw;
+  dc.x = m->ww - dc.w;
+  drawtext(stext, dc.norm, false);
+  xcb_copy_area(xcb_dpy, dc.drawable, m->barwin, dc.gc,
+		dc.x, 0, dc.x, 0, dc.w, bh);
+}
+
 void
 drawtext(const char *text, uint32_t col[ColLast], int invert) {
-  char buf[256];
-  int i;
+  char buf[sizeof stext];
+  int i, n;
   int16_t x, y;
   uint16_t h; int len, olen;
   xcb_rectangle_t r = { dc.x, dc.y, dc.w, dc.h };
@@ -805,7 +1116,50 @@ drawtext(const char *text, uint32_t col[ColLast], int invert) {
   //  if(dc.font.set)
   //  XmbDrawString(dpy, dc.drawable, dc.font.set, dc.gc_xlib, x, y, buf, len);
   //else
-  xcb_image_text_8(xcb_dpy, len, dc.drawable, dc.gc, x, y, buf);
+  for(i = 0; i < len; i += n) { /* ImageText8 takes up to 255 characters */
+    n = MIN(len - i, 255);
+    xcb_image_text_8(xcb_dpy, n, dc.drawable, dc.gc, x, y, buf + i);
+    x += textnw(buf + i, n);
+  }
+}
+
+/* Writes the trace ring to tracefile.<pid>, see trace.h.  It is written
+ * to a new file next to it and renamed into place, so readers never see
+ * a partial trace. */
+void
+dumptrace(void) {
+  TraceHeader h;
+  char path[256], tmp[256 + 4];
+  unsigned int i, n;
+  int fd, ok;
+
+  snprintf(path, sizeof path, "%s.%d", tracefile, (int)getpid());
+  snprintf(tmp, sizeof tmp, "%s.tmp", path);
+  unlink(tmp);
+  if((fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600)) == -1) {
+    fprintf(stderr, "dwm: cannot open %s: %s\n", tmp, strerror(errno));
+    return;
+  }
+  n = MIN(trace.n, TRACELEN);
+  i = (trace.n - n) % TRACELEN; /* oldest entry */
+  memset(&h, 0, sizeof h);
+  memcpy(h.magic, TRACEMAGIC, sizeof h.magic);
+  h.version = TRACEVERSION;
+  h.count = n;
+  ok = write(fd, &h, sizeof h) == sizeof h
+    && write(fd, &trace.e[i], (MIN(i + n, TRACELEN) - i) * sizeof *trace.e)
+       == (MIN(i + n, TRACELEN) - i) * sizeof *trace.e
+    && (i + n <= TRACELEN
+	|| write(fd, trace.e, (i + n - TRACELEN) * sizeof *trace.e)
+	   == (i + n - TRACELEN) * sizeof *trace.e);
+  if(close(fd) == -1 || (ok && rename(tmp, path) == -1))
+    ok = false;
+  if(ok)
+    fprintf(stderr, "dwm: wrote %u events to %s\n", n, path);
+  else {
+    fprintf(stderr, "dwm: cannot write %s: %s\n", path, strerror(errno));
+    unlink(tmp);
+  }
 }
 
 int
@@ -814,7 +1168,7 @@ enternotify(void *dummy, xcb_connection_t *dpy, xcb_enter_notify_event_t *ev) {
   Monitor *m;
 
   if((ev->mode != XCB_NOTIFY_MODE_NORMAL
-      || ev->detail == XCB_NOTIFY_DETAIL_INFERIOR) && ev->event != root)
+      || ev->detail == XCB_NOTIFY_DETAIL_INFERIOR) && !roottoscreen(ev->event))
     return 0;
   if((m = wintomon(ev->event)) && m != selmon) {
     unfocus(selmon->sel);
@@ -827,6 +1181,81 @@ enternotify(void *dummy, xcb_connection_t *dpy, xcb_enter_notify_event_t *ev) {
   return 1;
 }
 
+/* Returns a printable name of the event type, static for unknown types. */
+const char *
+evname(uint8_t type) {
+  static const char *names[] = {
+    [0] = "Error",
+    [XCB_KEY_PRESS] = "KeyPress", [XCB_KEY_RELEASE] = "KeyRelease",
+    [XCB_BUTTON_PRESS] = "ButtonPress", [XCB_BUTTON_RELEASE] = "ButtonRelease",
+    [XCB_MOTION_NOTIFY] = "MotionNotify", [XCB_ENTER_NOTIFY] = "EnterNotify",
+    [XCB_LEAVE_NOTIFY] = "LeaveNotify", [XCB_FOCUS_IN] = "FocusIn",
+    [XCB_FOCUS_OUT] = "FocusOut", [XCB_KEYMAP_NOTIFY] = "KeymapNotify",
+    [XCB_EXPOSE] = "Expose", [XCB_GRAPHICS_EXPOSURE] = "GraphicsExpose",
+    [XCB_NO_EXPOSURE] = "NoExposure", [XCB_VISIBILITY_NOTIFY] = "VisibilityNotify",
+    [XCB_CREATE_NOTIFY] = "CreateNotify", [XCB_DESTROY_NOTIFY] = "DestroyNotify",
+    [XCB_UNMAP_NOTIFY] = "UnmapNotify", [XCB_MAP_NOTIFY] = "MapNotify",
+    [XCB_MAP_REQUEST] = "MapRequest", [XCB_REPARENT_NOTIFY] = "ReparentNotify",
+    [XCB_CONFIGURE_NOTIFY] = "ConfigureNotify",
+    [XCB_CONFIGURE_REQUEST] = "ConfigureRequest",
+    [XCB_GRAVITY_NOTIFY] = "GravityNotify", [XCB_RESIZE_REQUEST] = "ResizeRequest",
+    [XCB_CIRCULATE_NOTIFY] = "CirculateNotify",
+    [XCB_CIRCULATE_REQUEST] = "CirculateRequest",
+    [XCB_PROPERTY_NOTIFY] = "PropertyNotify",
+    [XCB_SELECTION_CLEAR] = "SelectionClear",
+    [XCB_SELECTION_REQUEST] = "SelectionRequest",
+    [XCB_SELECTION_NOTIFY] = "SelectionNotify",
+    [XCB_COLORMAP_NOTIFY] = "ColormapNotify", [XCB_CLIENT_MESSAGE] = "ClientMessage",
+    [XCB_MAPPING_NOTIFY] = "MappingNotify",
+  };
+  static char buf[16];
+
+  type &= 0x7f;
+  if(type < LENGTH(names) && names[type])
+    return names[type];
+  snprintf(buf, sizeof buf, "event %u", type);
+  return buf;
+}
+
+xcb_window_t
+evwindow(xcb_generic_event_t *e) {
+  switch(e->response_type & 0x7f) {
+  case XCB_KEY_PRESS:
+  case XCB_KEY_RELEASE:
+  case XCB_BUTTON_PRESS:
+  case XCB_BUTTON_RELEASE:
+  case XCB_MOTION_NOTIFY:
+    return ((xcb_button_press_event_t *)e)->event;
+  case XCB_ENTER_NOTIFY:
+  case XCB_LEAVE_NOTIFY:
+    return ((xcb_enter_notify_event_t *)e)->event;
+  case XCB_FOCUS_IN:
+  case XCB_FOCUS_OUT:
+    return ((xcb_focus_in_event_t *)e)->event;
+  case XCB_EXPOSE:
+    return ((xcb_expose_event_t *)e)->window;
+  case XCB_DESTROY_NOTIFY:
+    return ((xcb_destroy_notify_event_t *)e)->window;
+  case XCB_UNMAP_NOTIFY:
+    return ((xcb_unmap_notify_event_t *)e)->window;
+  case XCB_MAP_NOTIFY:
+    return ((xcb_map_notify_event_t *)e)->window;
+  case XCB_MAP_REQUEST:
+    return ((xcb_map_request_event_t *)e)->window;
+  case XCB_CONFIGURE_NOTIFY:
+    return ((xcb_configure_notify_event_t *)e)->window;
+  case XCB_CONFIGURE_REQUEST:
+    return ((xcb_configure_request_event_t *)e)->window;
+  case XCB_PROPERTY_NOTIFY:
+    return ((xcb_property_notify_event_t *)e)->window;
+  case XCB_CLIENT_MESSAGE:
+    return ((xcb_client_message_event_t *)e)->window;
+  case 0:
+    return ((xcb_generic_error_t *)e)->resource_id;
+  }
+  return XCB_NONE;
+}
+
 int
 expose(void *dummy, xcb_connection_t *dpy, xcb_expose_event_t *ev) {
   Monitor *m;
@@ -847,19 +1276,25 @@ focus(Client *c) {
       selmon = c->mon;
     if(c->isurgent)
       clearurgent(c);
+    if(c->launched) {
+      latadd(&stats.launch[c->launchcmd].focus, now() - c->launched);
+      c->launched = 0;
+    }
     detachstack(c);
     attachstack(c);
     grabbuttons(c, true);
-    uint32_t border_color[] = { dc.sel[ColBorder] };
+    uint32_t border_color[] = { c->mon->scr->sel[ColBorder] };
     xcb_change_window_attributes(xcb_dpy, c->win, XCB_CW_BORDER_PIXEL, border_color);
     xcb_set_input_focus(xcb_dpy, XCB_INPUT_FOCUS_POINTER_ROOT,
 			c->win, XCB_TIME_CURRENT_TIME);
   }
   else
     xcb_set_input_focus(xcb_dpy, XCB_INPUT_FOCUS_POINTER_ROOT,
-			root, XCB_TIME_CURRENT_TIME);
+			selmon->scr->root, XCB_TIME_CURRENT_TIME);
   selmon->sel = c;
   drawbars();
+  notify(1 << SubFocus | 1 << SubTitle);
+  ewmhdirty |= 1 << EwmhActive | 1 << EwmhDesktop;
 }
 
 int
@@ -910,12 +1345,11 @@ focusstack(const Arg *arg) {
 }
 
 uint32_t
-getcolor(const uint16_t rgb[]) {
-  xcb_colormap_t cmap = screen->default_colormap;
+getcolor(xcb_colormap_t cmap, const uint16_t rgb[]) {
   xcb_alloc_color_cookie_t cookie;
   cookie = xcb_alloc_color(xcb_dpy, cmap, rgb[0], rgb[1], rgb[2]);
   xcb_alloc_color_reply_t *reply =
-    xcb_alloc_color_reply(xcb_dpy, cookie, &xerr);
+    REPLY(xcb_alloc_color_reply, xcb_dpy, cookie, &xerr);
 
   if(xerr) { xcb_error_print(); exit(1); }
   assert(reply);
@@ -925,11 +1359,11 @@ getcolor(const uint16_t rgb[]) {
 }
 
 int
-getrootptr(int16_t *x, int16_t *y) {
+getrootptr(xcb_window_t root, int16_t *x, int16_t *y) {
   xcb_query_pointer_cookie_t cookie;
   xcb_query_pointer_reply_t *reply;
   cookie = xcb_query_pointer(xcb_dpy, root);
-  reply = xcb_query_pointer_reply(xcb_dpy, cookie, &xerr);
+  reply = REPLY(xcb_query_pointer_reply, xcb_dpy, cookie, &xerr);
   if (xerr) xcb_error_print();
   assert(reply);
   int result = reply->same_screen;
@@ -966,7 +1400,7 @@ gettextprop(xcb_window_t w, xcb_atom_t atom, char *text, unsigned int size) {
   xcb_get_property_cookie_t cookie;
   xcb_get_text_property_reply_t tp;
   cookie = xcb_get_text_property(xcb_dpy, w, atom);
-  int ok = xcb_get_text_property_reply(xcb_dpy, cookie, &tp, &xerr);
+  int ok = REPLYOK(xcb_get_text_property_reply, xcb_dpy, cookie, &tp, &xerr);
   if(!ok) {
     xcb_error_print();
     return false;
@@ -1020,21 +1454,100 @@ grabkeys(void) {
     uint16_t modifiers[] = { 0, XCB_MOD_MASK_LOCK, numlockmask,
 				 numlockmask | XCB_MOD_MASK_LOCK };
     xcb_keycode_t *code;
+    int s;
 
-    xcb_ungrab_key(xcb_dpy, XCB_GRAB_ANY, root, XCB_MOD_MASK_ANY);
+    for(s = 0; s < nscreens; s++)
+      xcb_ungrab_key(xcb_dpy, XCB_GRAB_ANY, screens[s].root, XCB_MOD_MASK_ANY);
     for(i = 0; i < LENGTH(keys); i++) {
       if((code = xcb_key_symbols_get_keycode(keysyms, keys[i].keysym)))
 	{
-	  for(j = 0; j < LENGTH(modifiers); j++)
-	    xcb_grab_key(xcb_dpy, true, root,
-			 keys[i].mod | modifiers[j], code[0],
-			 XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
+	  for(s = 0; s < nscreens; s++)
+	    for(j = 0; j < LENGTH(modifiers); j++)
+	      xcb_grab_key(xcb_dpy, true, screens[s].root,
+			   keys[i].mod | modifiers[j], code[0],
+			   XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
 	  free(code);
 	}
     }
   }
 }
 
+/* Rebuilds monv in physical order and the grids used by ptrtomon(): the
+ * monitor edges cut each screen into cells, and per-pixel column and row
+ * tables map a point to its cell without searching. */
+void
+indexmons(void) {
+  unsigned int i, j, n, nx, ny;
+  int a, k, *xs, *ys;
+  Monitor *m;
+  Screen *s;
+
+  for(n = 0, m = mons; m; m = m->next, n++);
+  if(n > nmons && !(monv = realloc(monv, n * sizeof *monv)))
+    die("fatal: could not realloc() %u monitors\n", n);
+  for(i = 0, m = mons; m; m = m->next)
+    monv[i++] = m;
+  nmons = n;
+  qsort(monv, n, sizeof *monv, monposcmp);
+  for(i = 0; i < n; i++)
+    monv[i]->pos = i;
+
+  if(!(xs = malloc(2 * n * sizeof *xs)) || !(ys = malloc(2 * n * sizeof *ys)))
+    die("fatal: could not malloc() %u bytes\n", (unsigned int)(2 * n * sizeof *xs));
+  for(k = 0; k < nscreens; k++) {
+    s = &screens[k];
+    for(i = 0, m = mons; m; m = m->next)
+      if(m->scr == s) {
+	xs[i] = m->mx;
+	xs[i + 1] = m->mx + m->mw;
+	ys[i] = m->my;
+	ys[i + 1] = m->my + m->mh;
+	i += 2;
+      }
+    if(!i) {
+      s->grid.w = s->grid.h = 0;
+      continue;
+    }
+    qsort(xs, i, sizeof *xs, intcmp);
+    qsort(ys, i, sizeof *ys, intcmp);
+    for(j = nx = 1; j < i; j++)
+      if(xs[j] != xs[nx - 1])
+	xs[nx++] = xs[j];
+    for(j = ny = 1; j < i; j++)
+      if(ys[j] != ys[ny - 1])
+	ys[ny++] = ys[j];
+
+    s->grid.x = xs[0];
+    s->grid.y = ys[0];
+    s->grid.w = xs[nx - 1] - xs[0];
+    s->grid.h = ys[ny - 1] - ys[0];
+    s->grid.ncols = nx - 1;
+    if(!(s->grid.col = realloc(s->grid.col, (s->grid.w + 1) * sizeof *s->grid.col))
+       || !(s->grid.row = realloc(s->grid.row, (s->grid.h + 1) * sizeof *s->grid.row))
+       || !(s->grid.cell = realloc(s->grid.cell, nx * ny * sizeof *s->grid.cell)))
+      die("fatal: could not realloc() monitor grid %ux%u\n", s->grid.w, s->grid.h);
+    for(j = 0; j + 1 < nx; j++)
+      for(a = xs[j]; a < xs[j + 1]; a++)
+	s->grid.col[a - s->grid.x] = j;
+    for(j = 0; j + 1 < ny; j++)
+      for(a = ys[j]; a < ys[j + 1]; a++)
+	s->grid.row[a - s->grid.y] = j;
+    memset(s->grid.cell, 0, nx * ny * sizeof *s->grid.cell);
+    /* on overlaps the first monitor in the list wins */
+    for(m = mons; m; m = m->next)
+      if(m->scr == s)
+	for(j = 0; j + 1 < ny; j++)
+	  if(ys[j] >= m->my && ys[j] < m->my + m->mh)
+	    for(i = 0; i + 1 < nx; i++)
+	      if(xs[i] >= m->mx && xs[i] < m->mx + m->mw
+		 && !s->grid.cell[j * s->grid.ncols + i])
+		s->grid.cell[j * s->grid.ncols + i] = m;
+  }
+  free(xs);
+  free(ys);
+  notify(1 << SubMonitor);
+}
+
 void
 initfont(const char *fontstr) {
   /* char *def, **missing;
@@ -1068,19 +1581,19 @@ initfont(const char *fontstr) {
     dc.font.xfont = xcb_generate_id(xcb_dpy);
     cookie = xcb_open_font_checked(xcb_dpy, dc.font.xfont, strlen(fontstr), fontstr);
     cookie_lf = xcb_list_fonts_with_info(xcb_dpy, 1, strlen(fontstr), fontstr);
-    error = xcb_request_check(xcb_dpy, cookie);
+    error = REPLY(xcb_request_check, xcb_dpy, cookie);
     if(error != NULL) {
       free(error);
-      xcb_flush(xcb_dpy);
+      FLUSH();
       cookie = xcb_open_font_checked(xcb_dpy, dc.font.xfont, strlen("fixed"), "fixed");
       cookie_lf = xcb_list_fonts_with_info(xcb_dpy, 1, strlen("fixed"), "fixed");
-      error = xcb_request_check(xcb_dpy, cookie);
+      error = REPLY(xcb_request_check, xcb_dpy, cookie);
       if(error != NULL)
 	die("error, cannot load font: '%s'\n", fontstr);
     }
     // Get info
     xcb_list_fonts_with_info_reply_t *reply;
-    reply = xcb_list_fonts_with_info_reply(xcb_dpy, cookie_lf, NULL);
+    reply = REPLY(xcb_list_fonts_with_info_reply, xcb_dpy, cookie_lf, NULL);
     if (reply) {
       dc.font.ascent = reply->font_ascent;
       dc.font.descent = reply->font_descent;
@@ -1089,6 +1602,38 @@ initfont(const char *fontstr) {
       die("could not load font info for '%s'\n", fontstr);
     // }
   dc.font.height = dc.font.ascent + dc.font.descent;
+
+  /* keep the advances, so that measuring text costs no round-trip */
+  xcb_query_font_reply_t *qf;
+  xcb_charinfo_t *ci, zero = { 0 };
+  int i, j, n;
+  int16_t def;
+
+  qf = REPLY(xcb_query_font_reply, xcb_dpy, xcb_query_font(xcb_dpy, dc.font.xfont), NULL);
+  if(!qf)
+    die("could not query font '%s'\n", fontstr);
+  ci = xcb_query_font_char_infos(qf);
+  n = xcb_query_font_char_infos_length(qf);
+  for(i = 0; i < LENGTH(dc.font.width); i++) {
+    j = i - qf->min_char_or_byte2;
+    if(!n) /* all characters have the maximum metrics */
+      dc.font.width[i] = qf->max_bounds.character_width;
+    else if(i > qf->max_char_or_byte2 || j < 0 || j >= n
+	    || !memcmp(&ci[j], &zero, sizeof zero))
+      dc.font.width[i] = -1; /* nonexistent, drawn as default_char */
+    else
+      dc.font.width[i] = ci[j].character_width;
+  }
+  def = qf->default_char < LENGTH(dc.font.width) ? dc.font.width[qf->default_char] : -1;
+  for(i = 0; i < LENGTH(dc.font.width); i++)
+    if(dc.font.width[i] < 0)
+      dc.font.width[i] = MAX(def, 0);
+  free(qf);
+}
+
+int
+intcmp(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
 }
 
 int
@@ -1100,7 +1645,7 @@ isprotodel(const Client *c) {
   cookie = xcb_get_wm_protocols_unchecked(xcb_dpy, c->win, wmatom[WMProtocols]);
 
   xcb_get_wm_protocols_reply_t protocols;
-  if(xcb_get_wm_protocols_reply(xcb_dpy, cookie, &protocols, NULL)) {
+  if(REPLYOK(xcb_get_wm_protocols_reply, xcb_dpy, cookie, &protocols, NULL)) {
     for(i = 0; !ret && i < protocols.atoms_len; i++)
       if(protocols.atoms[i] == wmatom[WMDelete])
 	ret = true;
@@ -1123,6 +1668,250 @@ isuniquegeom(xcb_xinerama_screen_info_t *unique, size_t len,
 }
 #endif /* XINERAMA */
 
+/* Accepts a connection on the IPC socket. */
+void
+ipcaccept(int fd, short revents) {
+  IpcConn *ic;
+  int cfd;
+
+  if((cfd = accept(fd, NULL, NULL)) == -1)
+    return;
+  if(nwatches == LENGTH(watches) || !(ic = calloc(1, sizeof *ic))) {
+    close(cfd);
+    return;
+  }
+  fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+  fcntl(cfd, F_SETFD, FD_CLOEXEC);
+  ic->fd = cfd;
+  ic->next = ipcconns;
+  ipcconns = ic;
+  watchfd(cfd, POLLIN, ipcio);
+}
+
+void
+ipcclose(IpcConn *ic) {
+  IpcConn **tc;
+
+  for(tc = &ipcconns; *tc && *tc != ic; tc = &(*tc)->next);
+  *tc = ic->next;
+  unwatchfd(ic->fd);
+  close(ic->fd);
+  free(ic->out);
+  free(ic);
+}
+
+/* Runs one request line, see the IPC section of dwm(1). */
+void
+ipccommand(IpcConn *ic, char *line) {
+  char *name, *s, *end;
+  unsigned int i, n;
+  Arg arg = {0};
+  Monitor *m;
+  Client *c;
+
+  if(!(name = strtok(line, " \t")))
+    return;
+  if(!strcmp(name, "subscribe")) {
+    ipcsubscribe(ic, strtok(NULL, ""));
+    return;
+  }
+  s = strtok(NULL, " \t");
+  if(!strcmp(name, "monitors")) {
+    for(i = 0; i < nmons; i++) {
+      m = monv[i];
+      ipcprintf(ic, "%u %s %d %d %d %d 0x%x %s%s\n", m->pos,
+		m->name[0] ? m->name : "-", m->mx, m->my, m->mw, m->mh,
+		m->tagset[m->seltags], m->ltsymbol, m == selmon ? " *" : "");
+    }
+  }
+  else if(!strcmp(name, "clients")) {
+    for(i = 0; i < nmons; i++)
+      for(c = monv[i]->clients; c; c = c->next)
+	ipcprintf(ic, "0x%x %u 0x%x %d %d %u %u %s%s%s %s\n", c->win,
+		  c->mon->pos, c->tags, c->x, c->y, c->w, c->h,
+		  c->isfloating ? "f" : "-", c->isurgent ? "u" : "-",
+		  c == selmon->sel ? "*" : "-", c->name);
+  }
+  else if(!strcmp(name, "tags")) {
+    for(i = 0; i < LENGTH(tags); i++) {
+      for(n = 0, m = mons; m; m = m->next)
+	for(c = m->clients; c; c = c->next)
+	  n += (c->tags & 1 << i) != 0;
+      ipcprintf(ic, "%u %s %u%s\n", i + 1, tags[i], n,
+		selmon->tagset[selmon->seltags] & 1 << i ? " *" : "");
+    }
+  }
+  else {
+    for(i = 0; i < LENGTH(commands) && strcmp(name, commands[i].name); i++);
+    if(i == LENGTH(commands)) {
+      ipcprintf(ic, "error unknown command %s\n", name);
+      return;
+    }
+    if(s) {
+      switch(commands[i].argtype) {
+      case CmdInt:
+	arg.i = strtol(s, &end, 10);
+	break;
+      case CmdFloat:
+	arg.f = strtof(s, &end);
+	break;
+      case CmdTag:
+	if(!strcmp(s, "all"))
+	  arg.ui = ~0;
+	else if((n = strtoul(s, &end, 10)) >= 1 && n <= LENGTH(tags))
+	  arg.ui = 1 << (n - 1);
+	else
+	  end = s;
+	break;
+      case CmdLayout:
+	for(n = 0; n < LENGTH(layouts) && strcmp(s, layouts[n].symbol); n++);
+	if(n < LENGTH(layouts))
+	  arg.v = &layouts[n];
+	else
+	  end = s;
+	break;
+      default:
+	end = s;
+      }
+      if(*s && end == s) {
+	ipcprintf(ic, "error bad argument %s\n", s);
+	return;
+      }
+    }
+    commands[i].func(&arg);
+  }
+  ipcprintf(ic, "ok\n");
+}
+
+/* Writes what the socket takes of the pending replies. */
+void
+ipcflush(IpcConn *ic) {
+  ssize_t n;
+
+  while(ic->outlen && (n = send(ic->fd, ic->out, ic->outlen, MSG_NOSIGNAL)) > 0) {
+    ic->outlen -= n;
+    memmove(ic->out, ic->out + n, ic->outlen);
+  }
+  if(ic->outlen && errno != EAGAIN && errno != EINTR)
+    ic->dead = true;
+  watchfd(ic->fd, ic->outlen ? POLLIN | POLLOUT : POLLIN, ipcio);
+}
+
+void
+ipcio(int fd, short revents) {
+  IpcConn *ic;
+  char *nl;
+  ssize_t n;
+
+  for(ic = ipcconns; ic && ic->fd != fd; ic = ic->next);
+  if(!ic)
+    return;
+  if(revents & POLLOUT)
+    ipcflush(ic);
+  if(revents & (POLLIN | POLLHUP | POLLERR)) {
+    n = read(fd, ic->in + ic->inlen, sizeof ic->in - ic->inlen);
+    if(n == -1 && (errno == EAGAIN || errno == EINTR))
+      return;
+    if(n <= 0) {
+      ipcclose(ic);
+      return;
+    }
+    ic->inlen += n;
+    while(!ic->dead && (nl = memchr(ic->in, '\n', ic->inlen))) {
+      *nl = '\0';
+      ipccommand(ic, ic->in);
+      ic->inlen -= nl + 1 - ic->in;
+      memmove(ic->in, nl + 1, ic->inlen);
+    }
+    if(ic->inlen == sizeof ic->in)
+      ic->dead = true; /* line too long */
+  }
+  if(ic->dead)
+    ipcclose(ic);
+}
+
+/* Queues a reply; a client which does not read its replies is dropped. */
+void
+ipcprintf(IpcConn *ic, const char *fmt, ...) {
+  va_list ap;
+  int n;
+
+  if(ic->dead)
+    return;
+  va_start(ap, fmt);
+  n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if(ic->outlen + n + 1 > ic->outsize) {
+    if(ic->outlen + n + 1 > IPCMAXOUT) {
+      ic->dead = true;
+      return;
+    }
+    ic->outsize = MIN(IPCMAXOUT, MAX(2 * ic->outsize, ic->outlen + n + 1));
+    if(!(ic->out = realloc(ic->out, ic->outsize)))
+      die("fatal: could not realloc() %u bytes\n", (unsigned int)ic->outsize);
+  }
+  va_start(ap, fmt);
+  vsnprintf(ic->out + ic->outlen, n + 1, fmt, ap);
+  va_end(ap);
+  ic->outlen += n;
+  ipcflush(ic);
+}
+
+/* Listens on ipcsocket in the runtime directory, see runtimepath(), and
+ * exports the path in DWM_SOCKET for the children. */
+void
+ipcsetup(void) {
+  struct sockaddr_un sa;
+  mode_t mask;
+
+  if(!ipcsocket[0])
+    return;
+  memset(&sa, 0, sizeof sa);
+  sa.sun_family = AF_UNIX;
+  if(!runtimepath(sa.sun_path, sizeof sa.sun_path, ipcsocket)) {
+    fputs("dwm: no runtime directory for the IPC socket\n", stderr);
+    return;
+  }
+  if((ipcfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+    fputs("dwm: cannot create IPC socket\n", stderr);
+    return;
+  }
+  fcntl(ipcfd, F_SETFD, FD_CLOEXEC);
+  unlink(sa.sun_path);
+  mask = umask(077);
+  /* the path may be taken by someone else, run without IPC then */
+  if(bind(ipcfd, (struct sockaddr *)&sa, sizeof sa) == -1 || listen(ipcfd, 8) == -1) {
+    fprintf(stderr, "dwm: cannot listen on %s: %s\n", sa.sun_path, strerror(errno));
+    umask(mask);
+    close(ipcfd);
+    ipcfd = -1;
+    return;
+  }
+  umask(mask);
+  strncpy(ipcpath, sa.sun_path, sizeof ipcpath);
+  setenv("DWM_SOCKET", ipcpath, 1);
+  watchfd(ipcfd, POLLIN, ipcaccept);
+}
+
+/* Turns the connection into a stream of state updates, see publish().
+ * Without names all streams are sent. */
+void
+ipcsubscribe(IpcConn *ic, char *streams) {
+  unsigned int i, mask = 0;
+  char *s;
+
+  for(s = streams ? strtok(streams, " \t") : NULL; s; s = strtok(NULL, " \t")) {
+    for(i = 0; i < SubLast && strcmp(s, subnames[i]); i++);
+    if(i == SubLast) {
+      ipcprintf(ic, "error unknown stream %s\n", s);
+      return;
+    }
+    mask |= 1 << i;
+  }
+  ic->subscribed = ic->pending = mask ? mask : (1 << SubLast) - 1;
+  ipcprintf(ic, "ok\n");
+}
+
 int
 keypress(void *dummy, xcb_connection_t *dpy, xcb_key_press_event_t *ev) {
   unsigned int i;
@@ -1164,7 +1953,56 @@ killclient(const Arg *arg) {
       xcb_event_set_error_handler(&evenths, i, (xcb_generic_error_handler_t)xerror, NULL);
     xcb_ungrab_server(xcb_dpy);
   }
-  xcb_flush(xcb_dpy);
+  FLUSH();
+}
+
+void
+latadd(Latency *l, uint64_t us) {
+  l->count++;
+  l->total += us;
+  l->max = MAX(l->max, us);
+  l->hist[latbucket(us)]++;
+}
+
+/* Returns the histogram bucket of a latency: bucket i < 2^i us, the last
+ * one takes the rest. */
+unsigned int
+latbucket(uint64_t us) {
+  unsigned int i;
+
+  for(i = 0; i < LATBUCKETS - 1 && us >= 1ULL << i; i++);
+  return i;
+}
+
+void
+latprint(const char *what, const Latency *l) {
+  unsigned int i;
+
+  if(!l->count)
+    return;
+  fprintf(stderr, "dwm: %s: %lu, %llu us avg, %llu us max\ndwm:  ", what, l->count,
+	  (unsigned long long)(l->total / l->count), (unsigned long long)l->max);
+  for(i = 0; i < LATBUCKETS; i++)
+    if(l->hist[i])
+      fprintf(stderr, " %s%lluus:%lu", i < LATBUCKETS - 1 ? "<" : ">=",
+	      1ULL << (i < LATBUCKETS - 1 ? i : i - 1), l->hist[i]);
+  fputc('\n', stderr);
+}
+
+/* Accounts the spawn-to-map latency of a new client whose _NET_WM_PID is
+ * that of a command started by spawn(); only its first window counts. */
+void
+launchmapped(Client *c, uint32_t pid) {
+  unsigned int i;
+
+  for(i = 0; i < LENGTH(launches); i++)
+    if(launches[i].time && launches[i].pid == (pid_t)pid) {
+      c->launched = launches[i].time;
+      c->launchcmd = launches[i].cmd;
+      latadd(&stats.launch[c->launchcmd].map, now() - c->launched);
+      launches[i].time = 0;
+      return;
+    }
 }
 
 void
@@ -1173,20 +2011,38 @@ manage(xcb_window_t w,
        xcb_get_geometry_cookie_t cookie_g) {
   static Client cz;
   Client *c, *t = NULL;
+  Monitor *m;
+  Screen *s;
   xcb_window_t trans = XCB_WINDOW_NONE;
 
+  /* geometry */
+  xcb_get_geometry_reply_t *geo = NULL;
+  geo = REPLY(xcb_get_geometry_reply, xcb_dpy, cookie_g, NULL);
+  if (!geo) return;
+  if(!(s = roottoscreen(geo->root)))
+    s = screens;
+
   if(!(c = malloc(sizeof(Client))))
     die("fatal: could not malloc() %u bytes\n", sizeof(Client));
   *c = cz;
   c->win = w;
   updatetitle(c);
 
-  /* transience */
+  /* transience, and the pid for launchmapped() in the same round-trip */
   xcb_get_property_cookie_t cookie =
     xcb_get_wm_transient_for(xcb_dpy, w);
-  xcb_get_wm_transient_for_reply(xcb_dpy, cookie, &trans, &xerr);
+  xcb_get_property_cookie_t cookie_pid =
+    xcb_get_property(xcb_dpy, 0, w, netatom[NetWMPid], XCB_ATOM_CARDINAL, 0, 1);
+  REPLYOK(xcb_get_wm_transient_for_reply, xcb_dpy, cookie, &trans, &xerr);
   if (xerr) xcb_error_print();
   else t = wintoclient(trans);
+  xcb_get_property_reply_t *pid = REPLY(xcb_get_property_reply, xcb_dpy, cookie_pid, NULL);
+  if(pid) {
+    if(pid->type == XCB_ATOM_CARDINAL && pid->format == 32
+       && xcb_get_property_value_length(pid) == 4)
+      launchmapped(c, *(uint32_t *)xcb_get_property_value(pid));
+    free(pid);
+  }
   if(t) {
     c->mon = t->mon;
     c->tags = t->tags;
@@ -1195,17 +2051,22 @@ manage(xcb_window_t w,
     c->mon = selmon;
     applyrules(c);
   }
-
-  /* geometry */
-  xcb_get_geometry_reply_t *geo = NULL;
-  geo = xcb_get_geometry_reply(xcb_dpy, cookie_g, NULL);
-  if (!geo) return;
+  if(c->mon->scr != s) { /* windows cannot change screens */
+    for(m = mons; m && m->scr != s; m = m->next);
+    c->mon = m ? m : mons;
+    c->tags = c->mon->tagset[c->mon->seltags] | (c->tags & SPTAG);
+  }
 
   c->x = geo->x + c->mon->wx;
   c->y = geo->y + c->mon->wy;
   c->w = geo->width;
   c->h = geo->height;
   c->oldbw = geo->border_width;
+  c->srv.x = geo->x;
+  c->srv.y = geo->y;
+  c->srv.w = geo->width;
+  c->srv.h = geo->height;
+  c->srv.bw = geo->border_width;
   free(geo);
 
   if(c->w == c->mon->mw && c->h == c->mon->mh) {
@@ -1224,9 +2085,15 @@ manage(xcb_window_t w,
 		      && (c->x + (c->w / 2) < c->mon->wx + c->mon->ww)) ? bh : c->mon->my);
     c->bw = borderpx;
   }
-  uint32_t bw = c->bw;
-  xcb_configure_window(xcb_dpy, c->win, XCB_CONFIG_WINDOW_BORDER_WIDTH, &bw);
-  uint32_t border_color[] = { dc.norm[ColBorder] };
+  if(hideunmap) { /* showhide() maps it if visible */
+    sendgeom(c, c->x, c->y);
+    c->ishidden = wa->map_state != XCB_MAP_STATE_VIEWABLE;
+  }
+  else {
+    sendgeom(c, c->x + 2 * SW(c->mon->scr), c->y); /* some windows require this */
+    c->ishidden = true;
+  }
+  uint32_t border_color[] = { c->mon->scr->norm[ColBorder] };
   xcb_change_window_attributes(xcb_dpy, w, XCB_CW_BORDER_PIXEL, border_color);
   configure(c); /* propagates border_width, if size doesn't change */
   updatesizehints(c);
@@ -1240,12 +2107,16 @@ manage(xcb_window_t w,
     xcb_raise_window(xcb_dpy, c->win);
   attach(c);
   attachstack(c);
-
-  uint32_t geom[] = {c->x + 2*sw, /* some windows require this */
-		     c->y, c->w, c->h };
-  xcb_configure_window(xcb_dpy, c->win, XCB_CONFIG_MOVERESIZE, geom);
-  xcb_map_window(xcb_dpy, c->win);
-  setclientstate(c, XCB_WM_STATE_NORMAL);
+  if(nclientlist == clientlistsize) {
+    clientlistsize = clientlistsize ? clientlistsize * 2 : 64;
+    if(!(clientlist = realloc(clientlist, clientlistsize * sizeof *clientlist)))
+      die("fatal: could not realloc() %u clients\n", clientlistsize);
+  }
+  clientlist[nclientlist].win = w;
+  clientlist[nclientlist++].scr = c->mon->scr;
+  if(!hideunmap)
+    xcb_map_window(xcb_dpy, c->win);
+  setclientstate(c, hideunmap && c->ishidden ? XCB_WM_STATE_ICONIC : XCB_WM_STATE_NORMAL);
   arrange(c->mon);
 }
 
@@ -1267,7 +2138,7 @@ maprequest(void *dummy, xcb_connection_t *dpy, xcb_map_request_event_t *ev) {
   xcb_drawable_t d = { ev->window };
   cookie_g = xcb_get_geometry_unchecked(xcb_dpy, d);
 
-  if(!(wa = xcb_get_window_attributes_reply(xcb_dpy, cookie, NULL)))
+  if(!(wa = REPLY(xcb_get_window_attributes_reply, xcb_dpy, cookie, NULL)))
     return 0;
   if(wa->override_redirect)
     return 1;
@@ -1277,40 +2148,145 @@ maprequest(void *dummy, xcb_connection_t *dpy, xcb_map_request_event_t *ev) {
   return 1;
 }
 
+/* Status modules, see modules[] in config.h.  Each writes its text into
+ * s->text, or empties it if there is nothing to show. */
 void
-monocle(Monitor *m) {
-  unsigned int n = 0;
-  Client *c;
+modbattery(ModuleState *s, const char *arg) {
+  char path[128], cap[16], st[32] = "";
 
-  for(c = m->clients; c; c = c->next)
-    if(ISVISIBLE(c))
-      n++;
-  if(n > 0) /* override layout symbol */
-    snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n);
-  for(c = nexttiled(m->clients); c; c = nexttiled(c->next))
-    resize(c, m->wx, m->wy, m->ww - 2 * c->bw, m->wh - 2 * c->bw, false);
+  snprintf(path, sizeof path, "/sys/class/power_supply/%s/capacity", arg);
+  if(readfile(path, cap, sizeof cap) <= 0) {
+    s->text[0] = '\0';
+    return;
+  }
+  snprintf(path, sizeof path, "/sys/class/power_supply/%s/status", arg);
+  readfile(path, st, sizeof st);
+  snprintf(s->text, sizeof s->text, "bat %d%%%s", atoi(cap),
+	   !strncmp(st, "Charging", 8) ? "+" : !strncmp(st, "Discharging", 11) ? "-" : "");
 }
 
 void
-movemouse(const Arg *arg) {
-  int16_t x, y, ocx, ocy, nx, ny;
-  Client *c;
-  Monitor *m;
-  xcb_generic_event_t *ev = NULL;
-  xcb_motion_notify_event_t *e;
+modclock(ModuleState *s, const char *arg) {
+  time_t t = time(NULL);
+  struct tm tm;
 
-  if(!(c = selmon->sel))
+  if(!localtime_r(&t, &tm) || !strftime(s->text, sizeof s->text, arg ? arg : "%c", &tm))
+    s->text[0] = '\0';
+}
+
+void
+modload(ModuleState *s, const char *arg) {
+  char buf[64];
+  float a, b, c;
+
+  if(readfile("/proc/loadavg", buf, sizeof buf) <= 0
+     || sscanf(buf, "%f %f %f", &a, &b, &c) != 3)
+    s->text[0] = '\0';
+  else
+    snprintf(s->text, sizeof s->text, "%.2f %.2f %.2f", a, b, c);
+}
+
+void
+modmem(ModuleState *s, const char *arg) {
+  char buf[512], *p, *q;
+  unsigned long total, avail;
+
+  if(readfile("/proc/meminfo", buf, sizeof buf) <= 0
+     || !(p = strstr(buf, "MemTotal:")) || !(q = strstr(buf, "MemAvailable:"))
+     || !(total = strtoul(p + 9, NULL, 10))) {
+    s->text[0] = '\0';
     return;
-  restack(selmon);
-  ocx = c->x;
-  ocy = c->y;
-  // Grab pointer
-  xcb_grab_pointer_cookie_t cookie;
-  cookie = xcb_grab_pointer(xcb_dpy, false, root, MOUSEMASK,
-			    XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC,
-			    XCB_WINDOW_NONE, cursor[CurMove], XCB_CURRENT_TIME);
+  }
+  avail = strtoul(q + 13, NULL, 10);
+  snprintf(s->text, sizeof s->text, "mem %lu%%", (total - MIN(avail, total)) * 100 / total);
+}
+
+/* Receive and transmit rates of the interface since the last run. */
+void
+modnet(ModuleState *s, const char *arg) {
+  static const char dirs[2][3] = { "rx", "tx" };
+  char path[128], buf[32];
+  uint64_t t = now(), v;
+  double rate;
+  int i, n = 0;
+  const char *unit;
+
+  s->text[0] = '\0';
+  for(i = 0; i < 2; i++) {
+    snprintf(path, sizeof path, "/sys/class/net/%s/statistics/%s_bytes", arg, dirs[i]);
+    if(readfile(path, buf, sizeof buf) <= 0)
+      return;
+    v = strtoull(buf, NULL, 10);
+    if(s->prevtime && t > s->prevtime) {
+      rate = (v - s->prev[i]) * 1000000.0 / (t - s->prevtime);
+      for(unit = "BKMG"; rate >= 1024 && unit[1]; unit++)
+	rate /= 1024;
+      n += snprintf(s->text + n, sizeof s->text - n, "%s%s %.0f%c",
+		    i ? " " : "", dirs[i], rate, *unit);
+    }
+    s->prev[i] = v;
+  }
+  s->prevtime = t;
+}
+
+/* Starts the status modules, if any are configured. */
+void
+modulessetup(void) {
+  unsigned int i;
+
+  for(i = 0; i < LENGTH(modules) && !modules[i].func; i++);
+  if(i == LENGTH(modules))
+    return;
+  hasmodules = true;
+  runmodules();
+}
+
+int
+monposcmp(const void *a, const void *b) {
+  const Monitor *m = *(Monitor *const *)a, *n = *(Monitor *const *)b;
+
+  if(m->scr != n->scr)
+    return m->scr < n->scr ? -1 : 1;
+  return m->mx != n->mx ? m->mx - n->mx : m->my - n->my;
+}
+
+void
+monocle(Monitor *m) {
+  Rect area = { m->wx, m->wy, m->ww, m->wh };
+  unsigned int n = 0;
+  Client *c;
+  Geom *g;
+
+  for(c = m->clients; c; c = c->next)
+    if(ISVISIBLE(c))
+      n++;
+  if(n > 0) /* override layout symbol */
+    snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d]", n);
+  g = tiledgeoms(m, &n);
+  layoutmonocle(&area, bh, resizehints, g, n);
+  tileplace(m, g);
+}
+
+void
+movemouse(const Arg *arg) {
+  int16_t x, y, ocx, ocy, nx, ny;
+  Client *c;
+  Monitor *m;
+  xcb_generic_event_t *ev = NULL;
+  xcb_motion_notify_event_t *e;
+
+  if(!(c = selmon->sel))
+    return;
+  restack(selmon);
+  ocx = c->x;
+  ocy = c->y;
+  // Grab pointer
+  xcb_grab_pointer_cookie_t cookie;
+  cookie = xcb_grab_pointer(xcb_dpy, false, c->mon->scr->root, MOUSEMASK,
+			    XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC,
+			    XCB_WINDOW_NONE, cursor[CurMove], XCB_CURRENT_TIME);
   xcb_grab_pointer_reply_t *reply;
-  reply = xcb_grab_pointer_reply(xcb_dpy, cookie, &xerr);
+  reply = REPLY(xcb_grab_pointer_reply, xcb_dpy, cookie, &xerr);
   if (xerr) xcb_error_print();
   assert(reply);
   if(reply->status != XCB_GRAB_STATUS_SUCCESS) {
@@ -1319,13 +2295,16 @@ movemouse(const Arg *arg) {
   }
   free(reply);
 
-  if(!getrootptr(&x, &y))
+  if(!getrootptr(c->mon->scr->root, &x, &y))
     return;
   do {
     // XCB does not provide an alternative to XMaskEvent
     if (ev) free(ev);
+    FLUSH();
     ev = xcb_wait_for_event(xcb_dpy);
     if (!ev) continue;
+    if(recfile) /* the drag is replayed from its motion and release */
+      record(ev, now());
     switch (ev->response_type) {
     case XCB_CONFIGURE_REQUEST:
     case XCB_EXPOSE:
@@ -1357,37 +2336,194 @@ movemouse(const Arg *arg) {
   } while(ev->response_type != XCB_BUTTON_RELEASE);
   if (ev) free(ev);
   xcb_ungrab_pointer(xcb_dpy, XCB_CURRENT_TIME);
-  xcb_flush(xcb_dpy);
-  if((m = ptrtomon(c->x + c->w / 2, c->y + c->h / 2)) != selmon) {
+  FLUSH();
+  if((m = ptrtomon(c->mon->scr, c->x + c->w / 2, c->y + c->h / 2)) != selmon) {
     sendmon(c, m);
     selmon = m;
     focus(NULL);
   }
 }
 
+/* Marks streams as changed for the subscribers, publish() sends them. */
+void
+notify(unsigned int streams) {
+  IpcConn *ic;
+
+  for(ic = ipcconns; ic; ic = ic->next)
+    ic->pending |= streams & ic->subscribed;
+}
+
 Client *
 nexttiled(Client *c) {
   for(; c && (c->isfloating || !ISVISIBLE(c)); c = c->next);
   return c;
 }
 
+uint64_t
+now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Returns the monitor under the pointer, on whichever screen holds it. */
 Monitor *
-ptrtomon(int x, int y) {
-  Monitor *m;
+pointermon(void) {
+  int16_t x, y;
+  int i;
 
-  for(m = mons; m; m = m->next)
-    if(INRECT(x, y, m->wx, m->wy, m->ww, m->wh))
-      return m;
+  for(i = 0; i < nscreens; i++)
+    if(getrootptr(screens[i].root, &x, &y))
+      return ptrtomon(&screens[i], x, y);
   return selmon;
 }
 
+Monitor *
+ptrtomon(Screen *s, int x, int y) {
+  Monitor *m = NULL;
+
+  if(INRECT(x, y, s->grid.x, s->grid.y, s->grid.w, s->grid.h))
+    m = s->grid.cell[s->grid.row[y - s->grid.y] * s->grid.ncols
+		     + s->grid.col[x - s->grid.x]];
+  if(!m) /* in a gap, keep to the screen */
+    for(m = selmon->scr == s ? selmon : mons; m && m->scr != s; m = m->next);
+  return m ? m : selmon;
+}
+
+#ifdef XRANDR
+/* CRTC geometry changes are applied to their monitor directly, anything
+ * else (outputs enabled, disabled or plugged) requeries the outputs once
+ * the event queue is drained. */
+int
+randrnotify(void *dummy, xcb_connection_t *dpy, xcb_generic_event_t *e) {
+  xcb_randr_notify_event_t *ev = (xcb_randr_notify_event_t *)e;
+  xcb_randr_crtc_change_t *cc = &ev->u.cc;
+  Monitor *m;
+
+  if((e->response_type & 0x7f) != randrbase + XCB_RANDR_NOTIFY
+     || ev->subCode == XCB_RANDR_NOTIFY_OUTPUT_CHANGE)
+    geomstale = true;
+  else if(ev->subCode == XCB_RANDR_NOTIFY_CRTC_CHANGE) {
+    for(m = mons; m && m->crtc != cc->crtc; m = m->next);
+    if(!m) {
+      if(cc->mode != XCB_NONE)
+	geomstale = true;
+    }
+    else if(cc->mode == XCB_NONE)
+      geomstale = true;
+    else if(cc->x != m->mx || cc->y != m->my
+	    || cc->width != m->mw || cc->height != m->mh) {
+      m->mx = m->wx = cc->x;
+      m->my = m->wy = cc->y;
+      m->mw = m->ww = cc->width;
+      m->mh = m->wh = cc->height;
+      updatebarpos(m);
+      m->dirty = true;
+      indexmons();
+    }
+  }
+  return 1;
+}
+#endif /* XRANDR */
+
+void
+printstats(void) {
+  const char *const *cmd, *name;
+  char what[64];
+  unsigned int i, j;
+
+  fprintf(stderr, "dwm: %lu round-trips, %lu flushes, %lu restacks sent, %lu saved\n",
+	  stats.roundtrips, stats.flushes, stats.restacked, stats.restacksaved);
+  for(i = 0; i < LENGTH(stats.ev); i++) {
+    if(!stats.ev[i].count)
+      continue;
+    fprintf(stderr, "dwm: %-16s %8lu events, %6llu us avg, %8llu us max,"
+	    " %.2f round-trips, %.2f flushes\ndwm:  ", evname(i), stats.ev[i].count,
+	    (unsigned long long)(stats.ev[i].total / stats.ev[i].count),
+	    (unsigned long long)stats.ev[i].max,
+	    (double)stats.ev[i].roundtrips / stats.ev[i].count,
+	    (double)stats.ev[i].flushes / stats.ev[i].count);
+    for(j = 0; j < LATBUCKETS; j++)
+      if(stats.ev[i].hist[j])
+	fprintf(stderr, " %s%lluus:%lu", j < LATBUCKETS - 1 ? "<" : ">=",
+		1ULL << (j < LATBUCKETS - 1 ? j : j - 1), stats.ev[i].hist[j]);
+    fputc('\n', stderr);
+  }
+  for(i = 0; i < REPLYSITES; i++)
+    if(stats.site[i].count)
+      fprintf(stderr, "dwm: %s:%d %lu replies, %llu us waited\n",
+	      stats.site[i].func, stats.site[i].line, stats.site[i].count,
+	      (unsigned long long)stats.site[i].wait);
+  if(stats.spawnfailed)
+    fprintf(stderr, "dwm: %lu spawns failed\n", stats.spawnfailed);
+  latprint("spawn to exec", &stats.spawn);
+  for(i = 0; i < LENGTH(stats.launch) && stats.launch[i].cmd; i++) {
+    /* name shell commands by their script */
+    cmd = stats.launch[i].cmd;
+    name = cmd[1] && !strcmp(cmd[1], "-c") && cmd[2] ? cmd[2] : cmd[0];
+    snprintf(what, sizeof what, "%.48s spawn to map", name);
+    latprint(what, &stats.launch[i].map);
+    snprintf(what, sizeof what, "%.48s spawn to focus", name);
+    latprint(what, &stats.launch[i].focus);
+  }
+}
+
+/* Sends each subscriber the current state of the streams which changed
+ * since it was last sent, one line per monitor.  Changes coalesce until a
+ * subscriber has read most of what was queued, so a slow one gets fewer,
+ * newer updates instead of holding up dwm or growing its queue. */
+void
+publish(void) {
+  IpcConn *ic, *next;
+  unsigned int occ, urg, i;
+  Monitor *m;
+  Client *c;
+
+  for(ic = ipcconns; ic; ic = next) {
+    next = ic->next;
+    if(!ic->pending || ic->outlen >= IPCLOWAT)
+      continue;
+    if(ic->pending & 1 << SubMonitor) {
+      ipcprintf(ic, "monitors %u\n", nmons);
+      for(i = 0; i < nmons; i++)
+	ipcprintf(ic, "monitor %u %s %d %d %d %d\n", monv[i]->pos,
+		  monv[i]->name[0] ? monv[i]->name : "-",
+		  monv[i]->mx, monv[i]->my, monv[i]->mw, monv[i]->mh);
+    }
+    for(i = 0; i < nmons; i++) {
+      m = monv[i];
+      if(ic->pending & 1 << SubTags) {
+	for(occ = urg = 0, c = m->clients; c; c = c->next) {
+	  occ |= c->tags;
+	  if(c->isurgent)
+	    urg |= c->tags;
+	}
+	ipcprintf(ic, "tags %u 0x%x 0x%x 0x%x\n", m->pos,
+		  m->tagset[m->seltags], occ & TAGMASK, urg & TAGMASK);
+      }
+      if(ic->pending & 1 << SubLayout)
+	ipcprintf(ic, "layout %u %s\n", m->pos, m->ltsymbol);
+      if(ic->pending & 1 << SubTitle)
+	ipcprintf(ic, "title %u 0x%x %s\n", m->pos,
+		  m->sel ? m->sel->win : 0, m->sel ? m->sel->name : "");
+    }
+    if(ic->pending & 1 << SubFocus)
+      ipcprintf(ic, "focus %u 0x%x\n", selmon->pos,
+		selmon->sel ? selmon->sel->win : 0);
+    ic->pending = 0;
+    if(ic->dead)
+      ipcclose(ic);
+  }
+}
+
 int
 propertynotify(void *dummy, xcb_connection_t *Xdpy, xcb_property_notify_event_t *ev) {
   Client *c;
   xcb_window_t trans;
   xcb_get_property_cookie_t cookie;
 
-  if((ev->window == root) && (ev->atom == XCB_ATOM_WM_NAME))
+  if((ev->window == screens[defscreen].root) && (ev->atom == XCB_ATOM_WM_NAME))
     updatestatus();
   else if(ev->state == XCB_PROPERTY_DELETE)
     return 0; /* ignore */
@@ -1396,7 +2532,7 @@ propertynotify(void *dummy, xcb_connection_t *Xdpy, xcb_property_notify_event_t
     default: break;
     case XCB_ATOM_WM_TRANSIENT_FOR:
       cookie = xcb_get_wm_transient_for_unchecked(xcb_dpy, c->win);
-      xcb_get_wm_transient_for_reply(xcb_dpy, cookie, &trans, NULL);
+      REPLYOK(xcb_get_wm_transient_for_reply, xcb_dpy, cookie, &trans, NULL);
       if(!c->isfloating && (c->isfloating = (wintoclient(trans) != NULL)))
 	arrange(c->mon);
       break;
@@ -1408,11 +2544,9 @@ propertynotify(void *dummy, xcb_connection_t *Xdpy, xcb_property_notify_event_t
       drawbars();
       break;
     }
-    if(ev->atom == XCB_ATOM_WM_NAME || ev->atom == netatom[NetWMName]) {
-      updatetitle(c);
-      if(c == c->mon->sel)
-	drawbar(c->mon);
-    }
+    /* titles are fetched lazily by updatetitles() */
+    if(ev->atom == XCB_ATOM_WM_NAME || ev->atom == netatom[NetWMName])
+      c->titledirty = true;
   }
 
   return 1;
@@ -1423,16 +2557,140 @@ quit(const Arg *arg) {
   running = false;
 }
 
+/* Reads up to size - 1 bytes of path into buf, returns their count or -1. */
+int
+readfile(const char *path, char *buf, size_t size) {
+  ssize_t n;
+  int fd;
+
+  if((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+    return -1;
+  n = read(fd, buf, size - 1);
+  close(fd);
+  if(n < 0)
+    return -1;
+  buf[n] = '\0';
+  return n;
+}
+
+/* Appends the event to the recording, see trace.h. */
+void
+record(xcb_generic_event_t *e, uint64_t t) {
+  RecordEntry re;
+
+  re.time = t - recstart;
+  memcpy(re.event, e, sizeof re.event);
+  if(fwrite(&re, sizeof re, 1, recfile) != 1) {
+    fputs("dwm: cannot write recording, stopped\n", stderr);
+    fclose(recfile);
+    recfile = NULL;
+  }
+}
+
+/* Accounts a handler started at start which took t us, rt round-trips,
+ * fl flushes and rq requests, in the statistics and the trace ring. */
+void
+recordevent(xcb_generic_event_t *e, uint64_t start, uint64_t t,
+	    unsigned long rt, unsigned long fl, unsigned int rq) {
+  TraceEntry *te = &trace.e[trace.n++ % TRACELEN];
+  uint8_t type = e->response_type & 0x7f;
+  unsigned int i;
+
+  te->time = start;
+  te->window = evwindow(e);
+  te->duration = MIN(t, UINT32_MAX);
+  te->requests = MIN(rq, UINT16_MAX);
+  te->type = type;
+  te->roundtrips = MIN(rt, UINT8_MAX);
+  te->flushes = MIN(fl, UINT8_MAX);
+  if(maxroundtrips && rt > maxroundtrips)
+    fprintf(stderr, "dwm: %s handler took %lu round-trips, %llu us\n",
+	    evname(type), rt, (unsigned long long)t);
+  i = latbucket(t);
+  stats.ev[type].count++;
+  stats.ev[type].roundtrips += rt;
+  stats.ev[type].flushes += fl;
+  stats.ev[type].total += t;
+  stats.ev[type].max = MAX(stats.ev[type].max, t);
+  stats.ev[type].hist[i]++;
+}
+
+/* Moves the clients of m to the monitor to and destroys m. */
+void
+removemon(Monitor *m, Monitor *to) {
+  Client *c;
+
+  while(m->clients) {
+    c = m->clients;
+    m->clients = c->next;
+    detachstack(c);
+    if(m->name[0] && !c->home.mon[0]) {
+      strcpy(c->home.mon, m->name);
+      c->home.tags = c->tags;
+      c->home.x = c->x - m->mx;
+      c->home.y = c->y - m->my;
+      c->home.w = c->w;
+      c->home.h = c->h;
+    }
+    c->mon = to;
+    attach(c);
+    attachstack(c);
+    to->dirty = true;
+  }
+  if(m == selmon)
+    selmon = to;
+  cleanupmon(m);
+}
+
+/* REPLY() brackets every blocking reply with replybegin() and replyend(),
+ * which charge the wait to the calling source line. */
+void
+replybegin(void) {
+  stats.roundtrips++;
+  stats.replystart = now();
+}
+
+void *
+replyend(const char *func, int line, void *r) {
+  unsigned int i, n;
+
+  for(i = line % REPLYSITES, n = 0; n < REPLYSITES; i = (i + 1) % REPLYSITES, n++)
+    if(!stats.site[i].func || stats.site[i].line == line) {
+      stats.site[i].func = func;
+      stats.site[i].line = line;
+      stats.site[i].count++;
+      stats.site[i].wait += now() - stats.replystart;
+      break;
+    }
+  return r;
+}
+
+int
+replyok(const char *func, int line, int ok) {
+  replyend(func, line, NULL);
+  return ok;
+}
+
 void
 resize(Client *c, int16_t x, int16_t y, uint16_t w, uint16_t h, const int interact) {
   if(applysizehints(c, &x, &y, &w, &h, interact)) {
     c->x = x; c->y = y; c->w = w; c->h = h;
-    uint32_t geom[] = {x, y, w, h, c->bw};
-    xcb_configure_window(xcb_dpy, c->win, XCB_CONFIG_MOVERESIZE |
-			 XCB_CONFIG_WINDOW_BORDER_WIDTH, geom);
-    configure(c);
-    xcb_flush(xcb_dpy);
   }
+  /* hidden clients get their geometry when showhide() reveals them */
+  if(ISVISIBLE(c) && sendgeom(c, c->x, c->y))
+    configure(c);
+}
+
+/* Gives c a geometry computed by the layout functions, which have
+ * applied the size hints already. */
+void
+resizeclient(Client *c, const Rect *r) {
+  c->x = r->x;
+  c->y = r->y;
+  c->w = r->w;
+  c->h = r->h;
+  if(ISVISIBLE(c) && sendgeom(c, c->x, c->y))
+    configure(c);
 }
 
 void
@@ -1451,11 +2709,11 @@ resizemouse(const Arg *arg) {
   ocy = c->y;
   // Grab pointer
   xcb_grab_pointer_cookie_t cookie;
-  cookie = xcb_grab_pointer(xcb_dpy, false, root, MOUSEMASK,
+  cookie = xcb_grab_pointer(xcb_dpy, false, c->mon->scr->root, MOUSEMASK,
 			    XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC,
 			    XCB_WINDOW_NONE, cursor[CurResize], XCB_CURRENT_TIME);
   xcb_grab_pointer_reply_t *reply;
-  reply = xcb_grab_pointer_reply(xcb_dpy, cookie, &xerr);
+  reply = REPLY(xcb_grab_pointer_reply, xcb_dpy, cookie, &xerr);
   if (xerr) xcb_error_print();
   assert(reply);
   if(reply->status != XCB_GRAB_STATUS_SUCCESS) {
@@ -1469,7 +2727,12 @@ resizemouse(const Arg *arg) {
   do {
     // XCB does not provide an equivalent for XMaskEvent
     if (ev) free(ev);
+    FLUSH();
     ev = xcb_wait_for_event(xcb_dpy);
+    if(!ev)
+      break;
+    if(recfile)
+      record(ev, now());
     switch(ev->response_type) {
     case XCB_CONFIGURE_REQUEST:
     case XCB_EXPOSE:
@@ -1495,61 +2758,261 @@ resizemouse(const Arg *arg) {
   if(ev) free(ev);
   xcb_warp_pointer(xcb_dpy, XCB_NONE, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
   xcb_ungrab_pointer(xcb_dpy, XCB_CURRENT_TIME);
-  xcb_flush(xcb_dpy);
+  FLUSH();
   // while(XCheckMaskEvent(dpy, EnterWindowMask, &xev));
-  if((m = ptrtomon(c->x + c->w / 2, c->y + c->h / 2)) != selmon) {
+  if((m = ptrtomon(c->mon->scr, c->x + c->w / 2, c->y + c->h / 2)) != selmon) {
     sendmon(c, m);
     selmon = m;
     focus(NULL);
   }
 }
 
+/* Stacks the tiled clients below the bar in focus order. The clients
+ * forming the longest run which is still in the order of the previous
+ * restack() keep their place; the others are moved directly below their
+ * new predecessor. Usually a single window moves. */
 void
 restack(Monitor *m) {
+  static Client **v = NULL;
+  static unsigned int *tails = NULL, *link = NULL, size = 0;
+  static char *keep = NULL;
+  unsigned int i, n, len, lo, hi, mid;
   Client *c;
 
   drawbar(m);
+  ewmhdirty |= 1 << EwmhStacking;
   if(!m->sel)
     return;
-  if(m->sel->isfloating || !m->lt[m->sellt]->arrange)
+  if(m->sel->isfloating || !m->lt[m->sellt]->arrange) {
     xcb_raise_window(xcb_dpy, m->sel->win);
+    m->sel->stackgen = 0; /* no longer where the last restack put it */
+  }
   if(m->lt[m->sellt]->arrange) {
+    for(n = 0, c = m->stack; c; c = c->snext)
+      if(!c->isfloating && ISVISIBLE(c))
+	n++;
+    if(n > size) {
+      size = n;
+      if(!(v = realloc(v, size * sizeof *v))
+	 || !(tails = realloc(tails, size * sizeof *tails))
+	 || !(link = realloc(link, size * sizeof *link))
+	 || !(keep = realloc(keep, size)))
+	die("fatal: could not realloc() %u clients\n", size);
+    }
+    for(n = 0, c = m->stack; c; c = c->snext)
+      if(!c->isfloating && ISVISIBLE(c))
+	v[n++] = c;
+    /* longest increasing subsequence of the previous positions; tails[k] is
+     * the index of the smallest tail of a run of length k + 1 */
+    for(len = i = 0; i < n; i++) {
+      keep[i] = false;
+      if(!m->stackgen || v[i]->stackgen != m->stackgen)
+	continue;
+      for(lo = 0, hi = len; lo < hi;) {
+	mid = (lo + hi) / 2;
+	if(v[tails[mid]]->stackpos < v[i]->stackpos)
+	  lo = mid + 1;
+	else
+	  hi = mid;
+      }
+      link[i] = lo ? tails[lo - 1] : ~0U;
+      tails[lo] = i;
+      if(lo == len)
+	len++;
+    }
+    for(i = len ? tails[len - 1] : ~0U; i != ~0U; i = link[i])
+      keep[i] = true;
+    m->stackgen = ++restacks;
     uint32_t wc[] = { m->barwin, XCB_STACK_MODE_BELOW };
-    for(c = m->stack; c; c = c->snext)
-      if(!c->isfloating && ISVISIBLE(c)) {
-	xcb_configure_window(xcb_dpy, c->win,
+    for(i = 0; i < n; i++) {
+      if(keep[i])
+	stats.restacksaved++;
+      else {
+	xcb_configure_window(xcb_dpy, v[i]->win,
 			     XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE,
 			     wc);
-	wc[0] = c->win;
+	stats.restacked++;
       }
+      wc[0] = v[i]->win;
+      v[i]->stackgen = m->stackgen;
+      v[i]->stackpos = i;
+    }
   }
 
-  xcb_flush(xcb_dpy);
+  FLUSH();
 
   // while(XCheckMaskEvent(dpy, EnterWindowMask, &ev));
 }
 
+/* Moves clients displaced by removemon() back to their output once it
+ * is connected again.  Both monitors are only marked dirty, so a dock
+ * coming back is arranged in one go by updatemons(). */
+int
+restoreclients(void) {
+  Client *c, *next;
+  Monitor *m, *from;
+  int moved = false;
+
+  for(from = mons; from; from = from->next)
+    for(c = from->clients; c; c = next) {
+      next = c->next;
+      if(!c->home.mon[0])
+	continue;
+      for(m = mons; m && strcmp(m->name, c->home.mon); m = m->next);
+      if(!m)
+	continue;
+      c->home.mon[0] = '\0';
+      if(m == from)
+	continue;
+      detach(c);
+      detachstack(c);
+      c->mon = m;
+      c->tags = c->home.tags;
+      c->x = m->mx + c->home.x;
+      c->y = m->my + c->home.y;
+      c->w = c->home.w;
+      c->h = c->home.h;
+      attach(c);
+      attachstack(c);
+      from->dirty = m->dirty = moved = true;
+    }
+  return moved;
+}
+
+Screen *
+roottoscreen(xcb_window_t w) {
+  int i;
+
+  for(i = 0; i < nscreens; i++)
+    if(screens[i].root == w)
+      return &screens[i];
+  return NULL;
+}
+
+/* The X connection, the signals, the timers and the watched fds all wake
+ * one epoll_wait().  X events are taken from XCB's queue until it is
+ * empty before blocking, as waiting for a reply may have queued events
+ * without the fd staying readable. */
 void
 run(void) {
   xcb_generic_event_t *ev;
-
+  struct epoll_event ee[WATCHES];
+  int n, i;
+  uint64_t t;
+  unsigned long rt, fl;
+  unsigned int j, seq;
+  short revents;
+
+  if(countreqs)
+    trace.lastseq = xcb_no_operation(xcb_dpy).sequence;
   /* main event loop */
-  xcb_flush(xcb_dpy);
-  while(running && (ev = xcb_wait_for_event(xcb_dpy)))
-    {
+  while(running) {
+    if(!(ev = xcb_poll_for_event(xcb_dpy))) {
+      if(xcb_connection_has_error(xcb_dpy))
+	break;
+      /* the queue is drained, do the deferred work; it may have
+       * read further events while waiting for replies */
+      updatemons();
+      updatetitles();
+      publish();
+      updateewmh();
+      if(countreqs)
+	trace.lastseq = xcb_no_operation(xcb_dpy).sequence;
+      if(recfile)
+	fflush(recfile);
+      if(!(ev = xcb_poll_for_event(xcb_dpy))) {
+	FLUSH();
+	if((n = epoll_wait(epfd, ee, LENGTH(ee), -1)) == -1) {
+	  if(errno != EINTR)
+	    die("dwm: epoll_wait failed\n");
+	  continue;
+	}
+	/* the X fd has no watch, the loop reads it; callbacks may
+	 * change the watches, so each fd is looked up again */
+	for(i = 0; i < n; i++) {
+	  revents = (ee[i].events & EPOLLIN ? POLLIN : 0)
+	    | (ee[i].events & EPOLLOUT ? POLLOUT : 0)
+	    | (ee[i].events & EPOLLHUP ? POLLHUP : 0)
+	    | (ee[i].events & EPOLLERR ? POLLERR : 0);
+	  for(j = 0; j < nwatches; j++)
+	    if(watches[j].fd == ee[i].data.fd) {
+	      watches[j].func(ee[i].data.fd, revents);
+	      break;
+	    }
+	}
+	continue;
+      }
+    }
+    t = now();
+    if(recfile)
+      record(ev, t);
+    rt = stats.roundtrips;
+    fl = stats.flushes;
     xcb_event_handle(&evenths, ev); /* call handler */
+    /* with -t, the no-op's sequence number tells how many requests were
+     * sent; XCB has no other way to read it */
+    seq = countreqs ? xcb_no_operation(xcb_dpy).sequence : trace.lastseq + 1;
+    recordevent(ev, t, now() - t, stats.roundtrips - rt, stats.flushes - fl,
+		seq - trace.lastseq - 1);
+    trace.lastseq = seq;
     free(ev);
+  }
+}
+
+/* Runs the modules which are due, schedules itself for the next one and
+ * shows the result. */
+void
+runmodules(void) {
+  struct timespec rt;
+  uint64_t t = now(), next = 0, iv;
+  unsigned int i;
+
+  clock_gettime(CLOCK_REALTIME, &rt);
+  for(i = 0; i < LENGTH(modules); i++) {
+    if(!modules[i].func)
+      continue;
+    if(modstate[i].due <= t) {
+      modules[i].func(&modstate[i], modules[i].arg);
+      /* align to the wall clock, so that the clock ticks on the second */
+      iv = modules[i].interval * 1000ULL;
+      modstate[i].due = t + iv - ((uint64_t)rt.tv_sec * 1000000 + rt.tv_nsec / 1000) % iv;
     }
+    if(!next || modstate[i].due < next)
+      next = modstate[i].due;
+  }
+  settimer(runmodules, next);
+  buildstatus();
+}
+
+/* Writes name with the display name appended to path, in XDG_RUNTIME_DIR
+ * or, if that is unset, in /tmp/dwm-<uid>, which is created 0700 and
+ * refused unless it is a directory only we can use.  Returns false if
+ * there is no such directory or the path does not fit. */
+int
+runtimepath(char *path, size_t size, const char *name) {
+  const char *dir = getenv("XDG_RUNTIME_DIR"), *display = getenv("DISPLAY");
+  char tmp[32];
+  struct stat st;
+
+  if(!dir || !dir[0]) {
+    snprintf(tmp, sizeof tmp, "/tmp/dwm-%u", (unsigned int)getuid());
+    dir = tmp;
+    if((mkdir(dir, 0700) == -1 && errno != EEXIST)
+       || lstat(dir, &st) == -1 || !S_ISDIR(st.st_mode)
+       || st.st_uid != getuid() || st.st_mode & 077)
+      return false;
+  }
+  return snprintf(path, size, "%s/%s%s", dir, name, display ? display : "") < (int)size;
 }
 
 void
-scan(void) {
+scan(xcb_window_t root) {
   unsigned int i, num;
   xcb_window_t *wins = NULL;
 
   xcb_query_tree_cookie_t cookie = xcb_query_tree(xcb_dpy, root);
   xcb_query_tree_reply_t *qtree = NULL;
-  qtree = xcb_query_tree_reply(xcb_dpy, cookie, &xerr);
+  qtree = REPLY(xcb_query_tree_reply, xcb_dpy, cookie, &xerr);
   if (xerr) xcb_error_print();
   assert(qtree);
   num = qtree->children_len;
@@ -1563,6 +3026,8 @@ scan(void) {
     malloc(num * sizeof(xcb_get_property_cookie_t));
   xcb_get_property_cookie_t *cookie_h =
     malloc(num * sizeof(xcb_get_property_cookie_t));
+  xcb_get_property_cookie_t *cookie_st =
+    malloc(num * sizeof(xcb_get_property_cookie_t));
   xcb_get_geometry_cookie_t *cookie_g =
     malloc(num * sizeof(xcb_get_geometry_cookie_t));
   xcb_get_window_attributes_reply_t **wa =
@@ -1571,23 +3036,34 @@ scan(void) {
     cookie_wa[i] = xcb_get_window_attributes_unchecked(xcb_dpy, wins[i]);
     cookie_tr[i] = xcb_get_wm_transient_for_unchecked(xcb_dpy, wins[i]);
     cookie_h[i] = xcb_get_wm_hints_unchecked(xcb_dpy, wins[i]);
+    cookie_st[i] = xcb_get_property_unchecked(xcb_dpy, 0, wins[i], wmatom[WMState],
+					      wmatom[WMState], 0, 2);
     xcb_drawable_t d = { wins[i] };
     cookie_g[i] = xcb_get_geometry_unchecked(xcb_dpy, d);
   }
 
   // Go through children
   xcb_wm_hints_t hints;
+  xcb_get_property_reply_t *state;
+  int iconic;
   for(i=0; i<num; i++) {
     // Get attributes
-    wa[i] = xcb_get_window_attributes_reply(xcb_dpy, cookie_wa[i], NULL);
+    wa[i] = REPLY(xcb_get_window_attributes_reply, xcb_dpy, cookie_wa[i], NULL);
     if (!wa[i]) continue;
     // Check for transience
     xcb_window_t transient_for;
-    if(xcb_get_wm_transient_for_reply(xcb_dpy, cookie_tr[i], &transient_for, NULL))
+    if(REPLYOK(xcb_get_wm_transient_for_reply, xcb_dpy, cookie_tr[i], &transient_for, NULL))
       is_transient[i] = 1;
     // Manage window
-    xcb_get_wm_hints_reply(xcb_dpy, cookie_h[i], &hints, NULL);
-    if (wa[i]->map_state == XCB_MAP_STATE_VIEWABLE || (hints.initial_state == XCB_WM_STATE_ICONIC))
+    REPLYOK(xcb_get_wm_hints_reply, xcb_dpy, cookie_h[i], &hints, NULL);
+    // Windows hidden by unmapping are in IconicState
+    iconic = hints.initial_state == XCB_WM_STATE_ICONIC;
+    if((state = REPLY(xcb_get_property_reply, xcb_dpy, cookie_st[i], NULL))) {
+      if(xcb_get_property_value_length(state) >= 4)
+	iconic |= *(uint32_t *)xcb_get_property_value(state) == XCB_WM_STATE_ICONIC;
+      free(state);
+    }
+    if (wa[i]->map_state == XCB_MAP_STATE_VIEWABLE || iconic)
       {
 	if (is_transient[i]) continue; // wa[i] is not freed now
 	if (!(wa[i]->override_redirect)) manage(wins[i], wa[i], cookie_g[i]);
@@ -1600,6 +3076,7 @@ scan(void) {
   free(cookie_wa);
   free(cookie_tr);
   free(cookie_h);
+  free(cookie_st);
 
   for(i=0; i<num; i++)
     if (is_transient[i]) {
@@ -1613,15 +3090,51 @@ scan(void) {
   free(is_transient);
 }
 
+/* Moves the window to x, y with the client's size and border width, sending
+ * only the values which differ from the last ones sent to the server.
+ * Returns true if a request was issued. */
+int
+sendgeom(Client *c, int16_t x, int16_t y) {
+  uint32_t values[5];
+  uint16_t mask = 0;
+  int n = 0;
+
+  if(x != c->srv.x) {
+    mask |= XCB_CONFIG_WINDOW_X;
+    values[n++] = c->srv.x = x;
+  }
+  if(y != c->srv.y) {
+    mask |= XCB_CONFIG_WINDOW_Y;
+    values[n++] = c->srv.y = y;
+  }
+  if(c->w != c->srv.w) {
+    mask |= XCB_CONFIG_WINDOW_WIDTH;
+    values[n++] = c->srv.w = c->w;
+  }
+  if(c->h != c->srv.h) {
+    mask |= XCB_CONFIG_WINDOW_HEIGHT;
+    values[n++] = c->srv.h = c->h;
+  }
+  if(c->bw != c->srv.bw) {
+    mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH;
+    values[n++] = c->srv.bw = c->bw;
+  }
+  if(!mask)
+    return false;
+  xcb_configure_window(xcb_dpy, c->win, mask, values);
+  return true;
+}
+
 void
 sendmon(Client *c, Monitor *m) {
-  if(c->mon == m)
+  if(c->mon == m || c->mon->scr != m->scr) /* windows cannot change screens */
     return;
   unfocus(c);
   detach(c);
   detachstack(c);
   c->mon = m;
-  c->tags = m->tagset[m->seltags]; /* assign tags of target monitor */
+  c->tags = m->tagset[m->seltags] | (c->tags & SPTAG); /* assign tags of target monitor */
+  c->home.mon[0] = '\0';
   attach(c);
   attachstack(c);
   focus(NULL);
@@ -1666,17 +3179,71 @@ setmfact(const Arg *arg) {
 
 void
 setup(void) {
+  uint32_t ntags = LENGTH(tags);
+  sigset_t sigs;
+  struct epoll_event ee;
+
+  /* run() waits on everything through one epoll instance; signals arrive
+   * on a signalfd: SIGCHLD reaps children, SIGUSR1 prints the event
+   * statistics, SIGUSR2 dumps the event trace, the others quit */
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGCHLD);
+  sigaddset(&sigs, SIGUSR1);
+  sigaddset(&sigs, SIGUSR2);
+  sigaddset(&sigs, SIGHUP);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGTERM);
+  if((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1
+     || sigprocmask(SIG_BLOCK, &sigs, NULL) == -1
+     || (sigfd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC)) == -1
+     || (timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1)
+    die("dwm: cannot set up the event loop\n");
+  memset(&ee, 0, sizeof ee);
+  ee.events = EPOLLIN;
+  ee.data.fd = xcb_get_file_descriptor(xcb_dpy);
+  if(epoll_ctl(epfd, EPOLL_CTL_ADD, ee.data.fd, &ee) == -1)
+    die("dwm: cannot watch the X connection\n");
+  watchfd(sigfd, POLLIN, sigread);
+  watchfd(timerfd, POLLIN, timerexpired);
   /* clean up any zombies immediately */
-  sigchld(0);
+  while(0 < waitpid(-1, NULL, WNOHANG));
 
-  /* init screen */
-  screen = xcb_setup_roots_iterator(xcb_get_setup(xcb_dpy)).data;
-  root = screen->root;
+  /* init screens */
+  xcb_screen_iterator_t it = xcb_setup_roots_iterator(xcb_get_setup(xcb_dpy));
+  Screen *s;
+  int i;
+
+  nscreens = it.rem;
+  if(!(screens = calloc(nscreens, sizeof *screens)))
+    die("fatal: could not malloc() %u screens\n", nscreens);
+  for(i = 0; it.rem; xcb_screen_next(&it), i++) {
+    screens[i].xs = it.data;
+    screens[i].root = it.data->root;
+  }
+  if(defscreen >= nscreens)
+    defscreen = 0;
   /* check for other WM */
   checkotherwm();
   /* init geometry */
   initfont(font);
   bh = dc.h = dc.font.height + 2;
+#ifdef XRANDR
+  /* Zaphod screens have one monitor each */
+  const xcb_query_extension_reply_t *ext = xcb_get_extension_data(xcb_dpy, &xcb_randr_id);
+  if(nscreens == 1 && ext && ext->present) {
+    xcb_randr_query_version_reply_t *ver;
+    ver = REPLY(xcb_randr_query_version_reply, xcb_dpy,
+		xcb_randr_query_version(xcb_dpy, 1, 3), NULL);
+    if(ver && (ver->major_version > 1 || ver->minor_version >= 2)) {
+      randrbase = ext->first_event;
+      randrminor = ver->major_version > 1 ? 3 : ver->minor_version;
+      xcb_randr_select_input(xcb_dpy, screens[0].root, XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE
+			     | XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE
+			     | XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE);
+    }
+    free(ver);
+  }
+#endif /* XRANDR */
   updategeom();
   /* get keysyms */
   keysyms = xcb_key_symbols_alloc(xcb_dpy);
@@ -1694,34 +3261,48 @@ setup(void) {
   xcb_event_set_map_request_handler(&evenths, maprequest, NULL);
   xcb_event_set_property_notify_handler(&evenths, propertynotify, NULL);
   xcb_event_set_unmap_notify_handler(&evenths, unmapnotify, NULL);
+#ifdef XRANDR
+  if(randrbase >= 0) {
+    xcb_event_set_handler(&evenths, randrbase + XCB_RANDR_SCREEN_CHANGE_NOTIFY,
+			  randrnotify, NULL);
+    xcb_event_set_handler(&evenths, randrbase + XCB_RANDR_NOTIFY, randrnotify, NULL);
+  }
+#endif /* XRANDR */
   /* init error handler */
-  int i;
   for (i = 0; i < 256; ++i)
     xcb_event_set_error_handler(&evenths, i, (xcb_generic_error_handler_t)xerror, NULL);
   /* init atoms */
-  xcb_intern_atom_cookie_t atom_c[5];
+  static const char *netnames[NetLast] = {
+    [NetSupported] = "_NET_SUPPORTED", [NetWMName] = "_NET_WM_NAME",
+    [NetWMPid] = "_NET_WM_PID", [NetClientList] = "_NET_CLIENT_LIST",
+    [NetClientListStacking] = "_NET_CLIENT_LIST_STACKING",
+    [NetActiveWindow] = "_NET_ACTIVE_WINDOW",
+    [NetCurrentDesktop] = "_NET_CURRENT_DESKTOP",
+    [NetNumberOfDesktops] = "_NET_NUMBER_OF_DESKTOPS",
+  };
+  xcb_intern_atom_cookie_t atom_c[3], net_c[NetLast];
   atom_c[0] = xcb_intern_atom_unchecked(xcb_dpy, 0, strlen("WM_PROTOCOLS"), "WM_PROTOCOLS");
   atom_c[1] = xcb_intern_atom_unchecked(xcb_dpy, 0, strlen("WM_DELETE_WINDOW"), "WM_DELETE_WINDOW");
   atom_c[2] = xcb_intern_atom_unchecked(xcb_dpy, 0, strlen("WM_STATE"), "WM_STATE");
-  atom_c[3] = xcb_intern_atom_unchecked(xcb_dpy, 0, strlen("_NET_SUPPORTED"), "_NET_SUPPORTED");
-  atom_c[4] = xcb_intern_atom_unchecked(xcb_dpy, 0, strlen("_NET_WM_NAME"), "_NET_WM_NAME");
+  for(i = 0; i < NetLast; i++)
+    net_c[i] = xcb_intern_atom_unchecked(xcb_dpy, 0, strlen(netnames[i]), netnames[i]);
 
   xcb_intern_atom_reply_t *atom_reply;
-  atom_reply = xcb_intern_atom_reply(xcb_dpy, atom_c[0], NULL);
+  atom_reply = REPLY(xcb_intern_atom_reply, xcb_dpy, atom_c[0], NULL);
   if(atom_reply) { wmatom[WMProtocols] = atom_reply->atom; free(atom_reply); }
-  atom_reply = xcb_intern_atom_reply(xcb_dpy, atom_c[1], NULL);
+  atom_reply = REPLY(xcb_intern_atom_reply, xcb_dpy, atom_c[1], NULL);
   if(atom_reply) { wmatom[WMDelete] = atom_reply->atom; free(atom_reply); }
-  atom_reply = xcb_intern_atom_reply(xcb_dpy, atom_c[2], NULL);
+  atom_reply = REPLY(xcb_intern_atom_reply, xcb_dpy, atom_c[2], NULL);
   if(atom_reply) { wmatom[WMState] = atom_reply->atom; free(atom_reply); }
-  atom_reply = xcb_intern_atom_reply(xcb_dpy, atom_c[3], NULL);
-  if(atom_reply) { netatom[NetSupported] = atom_reply->atom; free(atom_reply); }
-  atom_reply = xcb_intern_atom_reply(xcb_dpy, atom_c[4], NULL);
-  if(atom_reply) { netatom[NetWMName] = atom_reply->atom; free(atom_reply); }
+  for(i = 0; i < NetLast; i++) {
+    atom_reply = REPLY(xcb_intern_atom_reply, xcb_dpy, net_c[i], NULL);
+    if(atom_reply) { netatom[i] = atom_reply->atom; free(atom_reply); }
+  }
   /* init cursors */
   xcb_font_t font = xcb_generate_id (xcb_dpy);
   xcb_void_cookie_t cookie_fc =
     xcb_open_font_checked(xcb_dpy, font, strlen("cursor"), "cursor");
-  xerr = xcb_request_check(xcb_dpy, cookie_fc);
+  xerr = REPLY(xcb_request_check, xcb_dpy, cookie_fc);
   if(xerr) {
     xcb_error_print();
     die("dwm: error loading cursor font\n");
@@ -1738,87 +3319,278 @@ setup(void) {
   xcb_create_glyph_cursor(xcb_dpy, cursor[CurMove], font, font,
 			  XC_fleur, XC_fleur + 1,
 			  0, 0, 0, 0xffff, 0xffff, 0xffff);
-  /* init appearance */
-  dc.norm[ColBorder] = getcolor(normbordercolor);
-  dc.norm[ColBG] = getcolor(normbgcolor);
-  dc.norm[ColFG] = getcolor(normfgcolor);
-  dc.sel[ColBorder] = getcolor(selbordercolor);
-  dc.sel[ColBG] = getcolor(selbgcolor);
-  dc.sel[ColFG] = getcolor(selfgcolor);
-  dc.drawable = xcb_generate_id(xcb_dpy);
-  xcb_create_pixmap(xcb_dpy, screen->root_depth, dc.drawable, root, sw, bh);
-  dc.gc = xcb_generate_id(xcb_dpy);
-  xcb_create_gc(xcb_dpy, dc.gc, root, 0, NULL);
+  /* init appearance, colors and GCs are per screen */
   uint32_t line_attrs[] = { 1, XCB_LINE_STYLE_SOLID, XCB_CAP_STYLE_BUTT,
 			    XCB_JOIN_STYLE_MITER };
-  xcb_change_gc(xcb_dpy, dc.gc, XCB_GC_LINE_WIDTH | XCB_GC_LINE_STYLE
-		| XCB_GC_CAP_STYLE | XCB_GC_JOIN_STYLE, line_attrs);
-  //  if(!dc.font.set)
-  xcb_change_gc(xcb_dpy, dc.gc, XCB_GC_FONT, &dc.font.xfont);
-  xcb_flush(xcb_dpy);
+  for(i = 0; i < nscreens; i++) {
+    s = &screens[i];
+    s->norm[ColBorder] = getcolor(s->xs->default_colormap, normbordercolor);
+    s->norm[ColBG] = getcolor(s->xs->default_colormap, normbgcolor);
+    s->norm[ColFG] = getcolor(s->xs->default_colormap, normfgcolor);
+    s->sel[ColBorder] = getcolor(s->xs->default_colormap, selbordercolor);
+    s->sel[ColBG] = getcolor(s->xs->default_colormap, selbgcolor);
+    s->sel[ColFG] = getcolor(s->xs->default_colormap, selfgcolor);
+    s->gc = xcb_generate_id(xcb_dpy);
+    xcb_create_gc(xcb_dpy, s->gc, s->root, 0, NULL);
+    xcb_change_gc(xcb_dpy, s->gc, XCB_GC_LINE_WIDTH | XCB_GC_LINE_STYLE
+		  | XCB_GC_CAP_STYLE | XCB_GC_JOIN_STYLE, line_attrs);
+    //  if(!dc.font.set)
+    xcb_change_gc(xcb_dpy, s->gc, XCB_GC_FONT, &dc.font.xfont);
+  }
+  FLUSH();
   /* init bars */
   updatebars();
+  modulessetup();
   updatestatus();
-  /* EWMH support per view */
-  xcb_change_property(xcb_dpy, XCB_PROP_MODE_REPLACE, root,
-		      netatom[NetSupported], XCB_ATOM_ATOM, 32,
-		      NetLast, netatom);
-  /* select for events */
-  uint32_t wa = cursor[CurNormal];
-  xcb_change_window_attributes(xcb_dpy, root, XCB_CW_CURSOR, &wa);
-  wa = XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |
-    XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_LEAVE_WINDOW |
-    XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
-  xcb_change_window_attributes(xcb_dpy, root, XCB_CW_EVENT_MASK, &wa);
+  for(i = 0; i < nscreens; i++) {
+    s = &screens[i];
+    /* EWMH support per view */
+    xcb_change_property(xcb_dpy, XCB_PROP_MODE_REPLACE, s->root,
+			netatom[NetSupported], XCB_ATOM_ATOM, 32,
+			NetLast, netatom);
+    xcb_change_property(xcb_dpy, XCB_PROP_MODE_REPLACE, s->root,
+			netatom[NetNumberOfDesktops], XCB_ATOM_CARDINAL, 32,
+			1, &ntags);
+    /* select for events */
+    uint32_t wa = cursor[CurNormal];
+    xcb_change_window_attributes(xcb_dpy, s->root, XCB_CW_CURSOR, &wa);
+    wa = XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |
+      XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_LEAVE_WINDOW |
+      XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes(xcb_dpy, s->root, XCB_CW_EVENT_MASK, &wa);
+  }
   grabkeys();
-  xcb_flush(xcb_dpy);
+  ipcsetup();
+  statussetup();
+  FLUSH();
 }
 
+/* Sets the external status text, redrawing only if the status changed. */
 void
-showhide(Client *c) {
-  if(!c)
-    return;
-  uint32_t geom[2];
-  if(ISVISIBLE(c)) { /* show clients top down */
-    geom[0] = c->x; geom[1] = c->y;
-    xcb_configure_window(xcb_dpy, c->win, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, geom);
-    if(!c->mon->lt[c->mon->sellt]->arrange || c->isfloating)
+setstatus(const char *text) {
+  strncpy(extstatus, text, sizeof extstatus - 1);
+  buildstatus();
+}
+
+/* Collects the clients to show at the front of v in stack order, and the
+ * clients to hide at its back in reverse stack order, then shows them top
+ * down and hides them bottom up without flushing. Clients which keep their
+ * state are skipped, except floating ones which need their size hints. */
+void
+showhide(Monitor *m) {
+  static Client **v = NULL;
+  static unsigned int size = 0;
+  unsigned int i, n, ns, nh;
+  Client *c;
+
+  for(n = 0, c = m->stack; c; c = c->snext, n++);
+  if(n > size) {
+    size = n;
+    if(!(v = realloc(v, size * sizeof *v)))
+      die("fatal: could not realloc() %u clients\n", size);
+  }
+  for(ns = 0, nh = n, c = m->stack; c; c = c->snext) {
+    if(ISVISIBLE(c)) {
+      if(c->ishidden || c->isfloating || !m->lt[m->sellt]->arrange)
+	v[ns++] = c;
+    }
+    else if(!c->ishidden)
+      v[--nh] = c;
+  }
+  for(i = 0; i < ns; i++) { /* show clients top down */
+    c = v[i];
+    if(c->ishidden) {
+      sendgeom(c, c->x, c->y);
+      if(hideunmap) {
+	xcb_map_window(xcb_dpy, c->win);
+	setclientstate(c, XCB_WM_STATE_NORMAL);
+      }
+      c->ishidden = false;
+    }
+    if(!m->lt[m->sellt]->arrange || c->isfloating)
       resize(c, c->x, c->y, c->w, c->h, false);
-    showhide(c->snext);
   }
-  else { /* hide clients bottom up */
-    showhide(c->snext);
-    geom[0] = c->x + 2 * sw; geom[1] = c->y;
-    xcb_configure_window(xcb_dpy, c->win, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, geom);
+  for(i = nh; i < n; i++) { /* hide clients bottom up */
+    c = v[i];
+    if(hideunmap) {
+      c->ignoreunmap++;
+      xcb_unmap_window(xcb_dpy, c->win);
+      setclientstate(c, XCB_WM_STATE_ICONIC);
+    }
+    else
+      sendgeom(c, c->x + 2 * SW(c->mon->scr), c->y);
+    c->ishidden = true;
   }
-  xcb_flush(xcb_dpy);
 }
 
 
+/* Schedules func to be called from run() at monotonic time due in us,
+ * replacing its pending call if any.  A due of 0 cancels.  The timers are
+ * few, so a plain array is scanned. */
 void
-sigchld(int unused) {
-  if(signal(SIGCHLD, sigchld) == SIG_ERR)
-    die("Can't install SIGCHLD handler");
-  while(0 < waitpid(-1, NULL, WNOHANG));
+settimer(void (*func)(void), uint64_t due) {
+  unsigned int i, slot = LENGTH(timers);
+
+  for(i = 0; i < LENGTH(timers); i++)
+    if(timers[i].func == func || (!timers[i].due && slot == LENGTH(timers)))
+      slot = i;
+  if(slot == LENGTH(timers))
+    die("fatal: more than %u timers\n", (unsigned int)LENGTH(timers));
+  timers[slot].func = func;
+  timers[slot].due = due;
+  armtimer();
+}
+
+/* Handles the signals blocked for the signalfd in setup(). */
+void
+sigread(int fd, short revents) {
+  struct signalfd_siginfo si;
+  unsigned int i;
+  pid_t pid;
+
+  while(read(fd, &si, sizeof si) == sizeof si)
+    switch(si.ssi_signo) {
+    case SIGCHLD:
+      while(0 < (pid = waitpid(-1, NULL, WNOHANG))) {
+	for(i = 0; i < LENGTH(launches); i++)
+	  if(launches[i].pid == pid) /* exited without a window */
+	    launches[i].time = 0;
+	if(pid == scratchpid)
+	  scratchpid = 0;
+      }
+      break;
+    case SIGUSR1:
+      printstats();
+      break;
+    case SIGUSR2:
+      dumptrace();
+      break;
+    default: /* SIGHUP, SIGINT, SIGTERM */
+      running = false;
+    }
 }
 
 void
 spawn(const Arg *arg) {
-  if(fork() == 0) {
-    if(xcb_dpy)
-      close(xcb_get_file_descriptor(xcb_dpy));
-    setsid();
-    execvp(((char **)arg->v)[0], (char **)arg->v);
-    fprintf(stderr, "dwm: execvp %s", ((char **)arg->v)[0]);
-    perror(" failed");
-    exit(0);
+  spawnpid(arg);
+}
+
+/* Starts a command without copying dwm's address space: posix_spawn()
+ * vforks, so it returns once the child has exec'd.  All of dwm's fds are
+ * close-on-exec; the child gets an empty signal mask, as dwm blocks the
+ * signals it reads from sigfd, and a session of its own; libcs without
+ * POSIX_SPAWN_SETSID give it a process group of its own instead.
+ * Returns the pid, or 0 if the command could not be started. */
+pid_t
+spawnpid(const Arg *arg) {
+  char *const *argv = (char *const *)arg->v;
+  posix_spawnattr_t attr;
+  sigset_t sigs;
+  uint64_t start, t;
+  unsigned int i, j, k;
+  pid_t pid;
+  int err;
+
+  sigemptyset(&sigs);
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setsigmask(&attr, &sigs);
+#ifdef POSIX_SPAWN_SETSID
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSID);
+#else
+  posix_spawnattr_setpgroup(&attr, 0);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+#endif
+  start = now();
+  err = posix_spawnp(&pid, argv[0], NULL, &attr, argv, environ);
+  t = now() - start;
+  posix_spawnattr_destroy(&attr);
+  if(err) {
+    stats.spawnfailed++;
+    fprintf(stderr, "dwm: cannot spawn %s: %s\n", argv[0], strerror(err));
+    return 0;
+  }
+  latadd(&stats.spawn, t);
+  /* remember the pid for launchmapped(), in a free or the oldest slot */
+  for(i = 0; i < LENGTH(stats.launch) && stats.launch[i].cmd
+	&& stats.launch[i].cmd != arg->v; i++);
+  if(i == LENGTH(stats.launch))
+    return pid;
+  stats.launch[i].cmd = arg->v;
+  for(j = k = 0; j < LENGTH(launches); j++)
+    if(launches[j].time < launches[k].time)
+      k = j;
+  launches[k].pid = pid;
+  launches[k].cmd = i;
+  launches[k].time = start;
+  return pid;
+}
+
+/* Reads status lines from the FIFO; of those which arrived together
+ * only the last one is shown.  Overlong lines are cut. */
+void
+statusread(int fd, short revents) {
+  static char buf[sizeof stext];
+  static unsigned int len = 0;
+  static int skip = false;  /* dropping the rest of an overlong line */
+  char *p, *nl, *last = NULL;
+  ssize_t n;
+
+  if((n = read(fd, buf + len, sizeof buf - len)) <= 0)
+    return;
+  len += n;
+  for(p = buf; (nl = memchr(p, '\n', buf + len - p)); p = nl + 1) {
+    *nl = '\0';
+    if(!skip)
+      last = p;
+    skip = false;
+  }
+  if(last)
+    setstatus(last);
+  len -= p - buf;
+  memmove(buf, p, len);
+  if(len == sizeof buf) {
+    buf[len - 1] = '\0';
+    if(!skip)
+      setstatus(buf);
+    skip = true;
+    len = 0;
+  }
+}
+
+/* Creates the status FIFO, statusfifo in the runtime directory, see
+ * runtimepath(), and exports its path in DWM_STATUS.  dwm holds a write
+ * end itself so that writers coming and going never make it see end of
+ * file.  The checks are on the opened fds, so the path cannot be swapped
+ * in between. */
+void
+statussetup(void) {
+  struct stat st, wst;
+
+  if(!statusfifo[0])
+    return;
+  if(!runtimepath(statuspath, sizeof statuspath, statusfifo)
+     || (mkfifo(statuspath, 0600) == -1 && errno != EEXIST)
+     || (statusfd[0] = open(statuspath, O_RDONLY | O_NONBLOCK | O_NOFOLLOW | O_CLOEXEC)) == -1
+     || fstat(statusfd[0], &st) == -1 || !S_ISFIFO(st.st_mode) || st.st_uid != getuid()
+     || (statusfd[1] = open(statuspath, O_WRONLY | O_NOFOLLOW | O_CLOEXEC)) == -1
+     || fstat(statusfd[1], &wst) == -1 || wst.st_dev != st.st_dev || wst.st_ino != st.st_ino) {
+    fprintf(stderr, "dwm: cannot use status FIFO %s\n", statuspath);
+    if(statusfd[0] != -1)
+      close(statusfd[0]);
+    if(statusfd[1] != -1)
+      close(statusfd[1]);
+    statusfd[0] = statusfd[1] = -1;
+    statuspath[0] = '\0';
+    return;
   }
+  setenv("DWM_STATUS", statuspath, 1);
+  watchfd(statusfd[0], POLLIN, statusread);
 }
 
 void
 tag(const Arg *arg) {
   if(selmon->sel && arg->ui & TAGMASK) {
-    selmon->sel->tags = arg->ui & TAGMASK;
+    selmon->sel->tags = (arg->ui & TAGMASK) | (selmon->sel->tags & SPTAG);
     arrange(selmon);
   }
 }
@@ -1832,57 +3604,68 @@ tagmon(const Arg *arg) {
 
 int
 textnw(const char *text, unsigned int len) {
-  /*  if(dc.font.set) {
-    XRectangle r;
-    XmbTextExtents(dc.font.set, text, len, NULL, &r);
-    return r.width;
-    } */
+  int w = 0;
 
-  xcb_char2b_t *text2 = (xcb_char2b_t *)calloc(len, sizeof(xcb_char2b_t));
-  int i;
-  for(i = 0; i < len; i++)
-    { text2[i].byte1 = 0; text2[i].byte2 = text[i]; }
-  xcb_query_text_extents_cookie_t cookie;
-  xcb_query_text_extents_reply_t *reply;
-  cookie = xcb_query_text_extents(xcb_dpy, dc.font.xfont, len, text2);
-  reply = xcb_query_text_extents_reply(xcb_dpy, cookie, &xerr);
-  free(text2);
-  if (xerr) xcb_error_print();
-  assert(reply);
-  int32_t w = reply->overall_width;
-  free(reply);
-  return(w);
+  while(len--)
+    w += dc.font.width[(unsigned char)*text++];
+  return w;
 }
 
 void
 tile(Monitor *m) {
-  int16_t x, y;
-  uint16_t h, w, mw;
-  unsigned int i, n;
+  Rect area = { m->wx, m->wy, m->ww, m->wh };
+  unsigned int n;
+  Geom *g;
+
+  g = tiledgeoms(m, &n);
+  layouttile(&area, m->mfact, bh, resizehints, g, n);
+  tileplace(m, g);
+}
+
+/* Collects the tiled clients of m, in order, for the layout functions. */
+Geom *
+tiledgeoms(Monitor *m, unsigned int *n) {
+  unsigned int i;
   Client *c;
 
-  for(n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++);
-  if(n == 0)
-    return;
-  /* master */
-  c = nexttiled(m->clients);
-  mw = lroundf(m->mfact * m->ww);
-  resize(c, m->wx, m->wy, (n == 1 ? m->ww : mw) - 2 * c->bw, m->wh - 2 * c->bw, false);
-  if(--n == 0)
-    return;
-  /* tile stack */
-  x = (m->wx + mw > c->x + c->w) ? c->x + c->w + 2 * c->bw : m->wx + mw;
-  y = m->wy;
-  w = (m->wx + mw > c->x + c->w) ? m->wx + m->ww - x : m->ww - mw;
-  h = m->wh / n;
-  if(h < bh)
-    h = m->wh;
-  for(i = 0, c = nexttiled(c->next); c; c = nexttiled(c->next), i++) {
-    resize(c, x, y, w - 2 * c->bw, /* remainder */ ((i + 1 == n)
-						    ? m->wy + m->wh - y - 2 * c->bw : h - 2 * c->bw), false);
-    if(h != m->wh)
-      y = c->y + HEIGHT(c);
+  for(*n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), (*n)++);
+  if(*n > ngeoms) {
+    ngeoms = *n * 2;
+    if(!(geoms = realloc(geoms, ngeoms * sizeof *geoms)))
+      die("fatal: could not realloc() %u geometries\n", ngeoms);
+  }
+  for(i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++) {
+    geoms[i].hints = &c->hints;
+    geoms[i].bw = c->bw;
   }
+  return geoms;
+}
+
+/* Applies the geometries computed for tiledgeoms(m). */
+void
+tileplace(Monitor *m, const Geom *g) {
+  Client *c;
+
+  for(c = nexttiled(m->clients); c; c = nexttiled(c->next), g++)
+    resizeclient(c, &g->r);
+}
+
+void
+timerexpired(int fd, short revents) {
+  uint64_t expirations, t = now();
+  void (*func)(void);
+  unsigned int i;
+
+  if(read(fd, &expirations, sizeof expirations) != sizeof expirations)
+    return;
+  timerarmed = 0; /* the timerfd is one-shot */
+  for(i = 0; i < LENGTH(timers); i++)
+    if(timers[i].due && timers[i].due <= t) {
+      func = timers[i].func;
+      timers[i].due = 0;
+      func();
+    }
+  armtimer();
 }
 
 void
@@ -1905,6 +3688,37 @@ togglefloating(const Arg *arg) {
   arrange(selmon);
 }
 
+/* Shows the scratchpad on the selected monitor or hides it, by giving it
+ * the tags in view or SPTAG alone.  Its command is only spawned if no
+ * client is the scratchpad and no launch of it is pending. */
+void
+togglescratch(const Arg *arg) {
+  const Arg sp = { .v = scratchpadcmd };
+  Monitor *m;
+  Client *c = NULL;
+
+  for(m = mons; m && !c; m = m->next)
+    for(c = m->clients; c && !(c->tags & SPTAG); c = c->next);
+  if(!c) {
+    if(!scratchpid)
+      scratchshow = (scratchpid = spawnpid(&sp)) != 0;
+    return;
+  }
+  /* windows cannot change screens, one on another screen is toggled on
+   * its own monitor */
+  m = c->mon->scr == selmon->scr ? selmon : c->mon;
+  if(c->mon == m && ISVISIBLE(c)) {
+    c->tags = SPTAG;
+    arrange(m);
+    return;
+  }
+  if(c->mon != m)
+    sendmon(c, m);
+  c->tags = SPTAG | m->tagset[m->seltags];
+  focus(c);
+  arrange(m);
+}
+
 void
 toggletag(const Arg *arg) {
   unsigned int newtags;
@@ -1933,16 +3747,37 @@ unfocus(Client *c) {
   if(!c)
     return;
   grabbuttons(c, false);
-  uint32_t border_color[] = { dc.norm[ColBorder] };
+  uint32_t border_color[] = { c->mon->scr->norm[ColBorder] };
   xcb_change_window_attributes(xcb_dpy, c->win, XCB_CW_BORDER_PIXEL, border_color);
   xcb_set_input_focus(xcb_dpy, XCB_INPUT_FOCUS_POINTER_ROOT,
-		      root, XCB_TIME_CURRENT_TIME);
+		      c->mon->scr->root, XCB_TIME_CURRENT_TIME);
+}
+
+/* Stops watching fd in run()'s poll. */
+void
+unwatchfd(int fd) {
+  unsigned int i;
+
+  for(i = 0; i < nwatches && watches[i].fd != fd; i++);
+  if(i < nwatches) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    watches[i] = watches[--nwatches];
+  }
 }
 
 void
 unmanage(Client *c, int destroyed) {
   Monitor *m = c->mon;
+  unsigned int i;
 
+  for(i = 0; i < nclientlist && clientlist[i].win != c->win; i++);
+  if(i < nclientlist) {
+    if(i < clientlistsent) { /* updateewmh() rewrites the list */
+      ewmhdirty |= 1 << EwmhClients;
+      clientlistsent = i;
+    }
+    memmove(&clientlist[i], &clientlist[i + 1], (--nclientlist - i) * sizeof *clientlist);
+  }
   /* The server grab construct avoids race conditions. */
   detach(c);
   detachstack(c);
@@ -1953,7 +3788,7 @@ unmanage(Client *c, int destroyed) {
     xcb_ungrab_button(xcb_dpy, XCB_GRAB_ANY, c->win, XCB_MOD_MASK_ANY);
     setclientstate(c, XCB_WM_STATE_WITHDRAWN);
     xcb_ungrab_server(xcb_dpy);
-    xcb_flush(xcb_dpy);
+    FLUSH();
   }
   free(c);
   focus(NULL);
@@ -1962,8 +3797,18 @@ unmanage(Client *c, int destroyed) {
 
 int
 unmapnotify(void *dummy, xcb_connection_t *dpy, xcb_unmap_notify_event_t *ev) {
-  Client *c = wintoclient(ev->window);
-  if(c) unmanage(c, false);
+  Client *c;
+
+  if(!(c = wintoclient(ev->window)))
+    return 1;
+  if(ev->response_type & 0x80) /* synthetic, the client withdraws (ICCCM 4.1.4) */
+    unmanage(c, false);
+  else if(ev->event != ev->window)
+    return 1; /* the same unmap as reported on the root window */
+  else if(c->ignoreunmap)
+    c->ignoreunmap--; /* hidden by showhide() */
+  else
+    unmanage(c, false);
   return 1;
 }
 
@@ -1976,10 +3821,21 @@ updatebars(void) {
   wa[0] = XCB_BACK_PIXMAP_PARENT_RELATIVE;
   wa[2] = XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_EXPOSURE;
   for(m = mons; m; m = m->next) {
+    /* the render target only follows width changes */
+    if(m->barpixw != m->ww) {
+      if(m->barpix)
+	xcb_free_pixmap(xcb_dpy, m->barpix);
+      m->barpix = xcb_generate_id(xcb_dpy);
+      xcb_create_pixmap(xcb_dpy, m->scr->xs->root_depth, m->barpix, m->scr->root,
+			m->ww, bh);
+      m->barpixw = m->ww;
+    }
+    if(m->barwin)
+      continue;
     m->barwin = xcb_generate_id(xcb_dpy);
-    xcb_create_window(xcb_dpy, screen->root_depth, m->barwin,
-		      root, m->wx, m->by, m->ww, bh, 0,
-		      XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+    xcb_create_window(xcb_dpy, m->scr->xs->root_depth, m->barwin,
+		      m->scr->root, m->wx, m->by, m->ww, bh, 0,
+		      XCB_WINDOW_CLASS_INPUT_OUTPUT, m->scr->xs->root_visual,
 		      XCB_CW_BACK_PIXMAP | XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK,
 		      wa);
     xcb_cursor_t value_list[] = { cursor[CurNormal] };
@@ -1988,7 +3844,7 @@ updatebars(void) {
     xcb_raise_window(xcb_dpy, m->barwin);
   }
 
-  xcb_flush(xcb_dpy);
+  FLUSH();
 }
 
 void
@@ -2004,20 +3860,160 @@ updatebarpos(Monitor *m) {
     m->by = -bh;
 }
 
+#ifdef XRANDR
+/* Matches the active RandR outputs to the monitors by output name, so that
+ * a monitor keeps its clients and settings while other outputs come and go.
+ * Clones are merged. Returns -1 if no output is active. */
+static int
+updaterandr(void) {
+  xcb_randr_get_screen_resources_current_reply_t *cur = NULL;
+  xcb_randr_get_screen_resources_reply_t *res = NULL;
+  xcb_randr_get_output_info_cookie_t *oc;
+  xcb_randr_get_output_info_reply_t *oi;
+  xcb_randr_get_crtc_info_cookie_t *cc;
+  xcb_randr_get_crtc_info_reply_t *ci;
+  xcb_randr_output_t *outputs;
+  xcb_timestamp_t ts;
+  Monitor *m, *next, *to, **tm;
+  int i, j, k, n, nn, len, dirty = false;
+  struct {
+    char name[sizeof mons->name];
+    uint32_t crtc;
+    int16_t x, y;
+    uint16_t w, h;
+  } *out;
+
+  if(randrminor >= 3) {
+    cur = REPLY(xcb_randr_get_screen_resources_current_reply, xcb_dpy,
+	    xcb_randr_get_screen_resources_current(xcb_dpy, screens[0].root), NULL);
+    if(!cur)
+      return -1;
+    outputs = xcb_randr_get_screen_resources_current_outputs(cur);
+    n = xcb_randr_get_screen_resources_current_outputs_length(cur);
+    ts = cur->config_timestamp;
+  }
+  else {
+    res = REPLY(xcb_randr_get_screen_resources_reply, xcb_dpy,
+	    xcb_randr_get_screen_resources(xcb_dpy, screens[0].root), NULL);
+    if(!res)
+      return -1;
+    outputs = xcb_randr_get_screen_resources_outputs(res);
+    n = xcb_randr_get_screen_resources_outputs_length(res);
+    ts = res->config_timestamp;
+  }
+  if(n <= 0) {
+    free(cur);
+    free(res);
+    return -1;
+  }
+  if(!(oc = malloc(n * sizeof *oc)) || !(cc = malloc(n * sizeof *cc))
+     || !(out = calloc(n, sizeof *out)))
+    die("fatal: could not malloc() %u outputs\n", n);
+  /* pipeline the output and then the CRTC queries */
+  for(i = 0; i < n; i++)
+    oc[i] = xcb_randr_get_output_info(xcb_dpy, outputs[i], ts);
+  for(i = nn = 0; i < n; i++) {
+    if(!(oi = REPLY(xcb_randr_get_output_info_reply, xcb_dpy, oc[i], NULL)))
+      continue;
+    if(oi->connection == XCB_RANDR_CONNECTION_CONNECTED && oi->crtc != XCB_NONE) {
+      len = MIN(xcb_randr_get_output_info_name_length(oi), sizeof out->name - 1);
+      memcpy(out[nn].name, xcb_randr_get_output_info_name(oi), len);
+      out[nn++].crtc = oi->crtc;
+    }
+    free(oi);
+  }
+  free(cur);
+  free(res);
+  for(i = 0; i < nn; i++)
+    cc[i] = xcb_randr_get_crtc_info(xcb_dpy, out[i].crtc, ts);
+  for(i = j = 0; i < nn; i++) {
+    if(!(ci = REPLY(xcb_randr_get_crtc_info_reply, xcb_dpy, cc[i], NULL)))
+      continue;
+    if(ci->mode != XCB_NONE && ci->width && ci->height) {
+      /* only consider unique geometries as separate monitors */
+      for(k = 0; k < j; k++)
+	if(out[k].x == ci->x && out[k].y == ci->y
+	   && out[k].w == ci->width && out[k].h == ci->height)
+	  break;
+      if(k == j) {
+	out[j] = out[i];
+	out[j].x = ci->x;
+	out[j].y = ci->y;
+	out[j].w = ci->width;
+	out[j++].h = ci->height;
+      }
+    }
+    free(ci);
+  }
+  nn = j;
+  free(oc);
+  free(cc);
+  if(!nn) {
+    free(out);
+    return -1;
+  }
+  for(m = mons; m; m = m->next)
+    m->crtc = 0;
+  for(i = 0; i < nn; i++) {
+    for(tm = &mons; *tm && strcmp((*tm)->name, out[i].name); tm = &(*tm)->next);
+    if(!*tm) { /* new output, append a monitor */
+      *tm = createmon();
+      strcpy((*tm)->name, out[i].name);
+    }
+    m = *tm;
+    m->crtc = out[i].crtc;
+    if(out[i].x != m->mx || out[i].y != m->my
+       || out[i].w != m->mw || out[i].h != m->mh) {
+      m->mx = m->wx = out[i].x;
+      m->my = m->wy = out[i].y;
+      m->mw = m->ww = out[i].w;
+      m->mh = m->wh = out[i].h;
+      updatebarpos(m);
+      m->dirty = dirty = true;
+    }
+  }
+  free(out);
+  /* monitors without a CRTC lost their output */
+  for(to = mons; !to->crtc; to = to->next);
+  for(m = mons; m; m = next) {
+    next = m->next;
+    if(!m->crtc) {
+      removemon(m, to);
+      dirty = true;
+    }
+  }
+  if(restoreclients())
+    dirty = true;
+  for(i = 0, m = mons; m; m = m->next)
+    m->num = i++;
+  return dirty;
+}
+#endif /* XRANDR */
+
 int
 updategeom(void) {
   int dirty = false;
 
+#ifdef XRANDR
+  if(randrbase >= 0 && (dirty = updaterandr()) >= 0) {
+    indexmons();
+    if(dirty) {
+      selmon = mons;
+      selmon = pointermon();
+    }
+    return dirty;
+  }
+  dirty = false;
+#endif /* XRANDR */
 #ifdef XINERAMA
   xcb_xinerama_is_active_cookie_t cookie;
   cookie = xcb_xinerama_is_active_unchecked(xcb_dpy);
   xcb_xinerama_is_active_reply_t *xinerama_r;
-  xinerama_r = xcb_xinerama_is_active_reply(xcb_dpy, cookie, NULL);
+  xinerama_r = REPLY(xcb_xinerama_is_active_reply, xcb_dpy, cookie, NULL);
   if(xinerama_r && xinerama_r->state) {
     free(xinerama_r);
 
     int i, j, n, nn;
-    Client *c;
     Monitor *m;
     xcb_xinerama_query_screens_cookie_t cookie;
     xcb_xinerama_query_screens_reply_t *reply_qs;
@@ -2027,7 +4023,7 @@ updategeom(void) {
     size_t sinfo_s = sizeof(xcb_xinerama_screen_info_t);
 
     cookie = xcb_xinerama_query_screens_unchecked(xcb_dpy);
-    reply_qs = xcb_xinerama_query_screens_reply(xcb_dpy, cookie, NULL);
+    reply_qs = REPLY(xcb_xinerama_query_screens_reply, xcb_dpy, cookie, NULL);
     info = xcb_xinerama_query_screens_screen_info(reply_qs);
     nn = xcb_xinerama_query_screens_screen_info_length(reply_qs);
 
@@ -2054,8 +4050,9 @@ updategeom(void) {
 	   || (unique[i].x_org != m->mx || unique[i].y_org != m->my
 	       || unique[i].width != m->mw || unique[i].height != m->mh))
 	  {
-	    dirty = true;
+	    dirty = m->dirty = true;
 	    m->num = i;
+	    snprintf(m->name, sizeof m->name, "xinerama%d", i);
 	    m->mx = m->wx = unique[i].x_org;
 	    m->my = m->wy = unique[i].y_org;
 	    m->mw = m->ww = unique[i].width;
@@ -2066,42 +4063,150 @@ updategeom(void) {
     else { /* less monitors available nn < n */
       for(i = nn; i < n; i++) {
 	for(m = mons; m && m->next; m = m->next);
-	while(m->clients) {
+	if(m->clients)
 	  dirty = true;
-	  c = m->clients;
-	  m->clients = c->next;
-	  detachstack(c);
-	  c->mon = mons;
-	  attach(c);
-	  attachstack(c);
-	}
-	if(m == selmon)
-	  selmon = mons;
-	cleanupmon(m);
+	removemon(m, mons);
       }
     }
+    if(restoreclients())
+      dirty = true;
     free(unique);
   }
   else
 #endif /* XINERAMA */
-    /* default monitor setup */
+    /* default monitor setup, one per screen */
     {
-      if(!mons)
-	mons = createmon();
-      if(mons->mw != sw || mons->mh != sh) {
-	dirty = true;
-	mons->mw = mons->ww = sw;
-	mons->mh = mons->wh = sh;
-	updatebarpos(mons);
+      Monitor *m, **tm;
+      int i;
+
+      for(i = 0, tm = &mons; i < nscreens; i++, tm = &(*tm)->next) {
+	if(!*tm) {
+	  *tm = createmon();
+	  (*tm)->scr = &screens[i];
+	}
+	m = *tm;
+	if(m->mw != SW(m->scr) || m->mh != SH(m->scr)) {
+	  dirty = m->dirty = true;
+	  m->num = i;
+	  m->mw = m->ww = SW(m->scr);
+	  m->mh = m->wh = SH(m->scr);
+	  updatebarpos(m);
+	}
       }
     }
+  indexmons();
   if(dirty) {
     selmon = mons;
-    selmon = wintomon(root);
+    selmon = pointermon();
   }
   return dirty;
 }
 
+/* Brings the EWMH root properties up to date, once per event batch.  New
+ * clients are appended to _NET_CLIENT_LIST, which is only rewritten when
+ * one that was sent went away; _NET_ACTIVE_WINDOW and _NET_CURRENT_DESKTOP
+ * are only written when their value changed. */
+void
+updateewmh(void) {
+  static xcb_window_t *v = NULL, lastactive = ~0U;
+  static unsigned int size = 0, lastdesktop = ~0U;
+  static Screen *lastscr = NULL;
+  unsigned int i, j, n, k, desktop, actchanged;
+  xcb_window_t active, w;
+  Monitor *m;
+  Client *c;
+  Screen *s;
+
+  if(!ewmhdirty && clientlistsent == nclientlist)
+    return;
+  if(nclientlist > size) {
+    size = nclientlist;
+    if(!(v = realloc(v, size * sizeof *v)))
+      die("fatal: could not realloc() %u windows\n", size);
+  }
+  active = selmon->sel ? selmon->sel->win : XCB_WINDOW_NONE;
+  for(desktop = 0; desktop < LENGTH(tags) - 1
+	&& !(selmon->tagset[selmon->seltags] & 1 << desktop); desktop++);
+  actchanged = active != lastactive || selmon->scr != lastscr;
+  for(i = 0; i < nscreens; i++) {
+    s = &screens[i];
+    if(ewmhdirty & 1 << EwmhClients || clientlistsent < nclientlist) {
+      j = ewmhdirty & 1 << EwmhClients ? 0 : clientlistsent;
+      for(n = 0; j < nclientlist; j++)
+	if(clientlist[j].scr == s)
+	  v[n++] = clientlist[j].win;
+      if(n || ewmhdirty & 1 << EwmhClients)
+	xcb_change_property(xcb_dpy, ewmhdirty & 1 << EwmhClients
+			    ? XCB_PROP_MODE_REPLACE : XCB_PROP_MODE_APPEND,
+			    s->root, netatom[NetClientList], XCB_ATOM_WINDOW, 32, n, v);
+    }
+    if(ewmhdirty & 1 << EwmhStacking) {
+      /* bottom to top: per monitor the tiled and hidden clients below the
+       * floating ones, each by focus history as restack() orders them */
+      for(n = 0, m = mons; m; m = m->next) {
+	if(m->scr != s)
+	  continue;
+	for(k = n, c = m->stack; c; c = c->snext)
+	  if(ISVISIBLE(c) && (c->isfloating || !m->lt[m->sellt]->arrange))
+	    v[n++] = c->win;
+	for(c = m->stack; c; c = c->snext)
+	  if(!ISVISIBLE(c) || !(c->isfloating || !m->lt[m->sellt]->arrange))
+	    v[n++] = c->win;
+	for(j = n; k + 1 < j; k++) {
+	  w = v[k];
+	  v[k] = v[--j];
+	  v[j] = w;
+	}
+      }
+      xcb_change_property(xcb_dpy, XCB_PROP_MODE_REPLACE, s->root,
+			  netatom[NetClientListStacking], XCB_ATOM_WINDOW, 32, n, v);
+    }
+    if(actchanged) {
+      w = s == selmon->scr ? active : XCB_WINDOW_NONE;
+      xcb_change_property(xcb_dpy, XCB_PROP_MODE_REPLACE, s->root,
+			  netatom[NetActiveWindow], XCB_ATOM_WINDOW, 32, 1, &w);
+    }
+    if(desktop != lastdesktop)
+      xcb_change_property(xcb_dpy, XCB_PROP_MODE_REPLACE, s->root,
+			  netatom[NetCurrentDesktop], XCB_ATOM_CARDINAL, 32, 1, &desktop);
+  }
+  lastactive = active;
+  lastscr = selmon->scr;
+  lastdesktop = desktop;
+  clientlistsent = nclientlist;
+  ewmhdirty = 0;
+}
+
+/* Applies monitor changes. Requeries the outputs if RandR reported a change
+ * which needs it, then creates and moves the bars and arranges only the
+ * monitors whose geometry changed. */
+void
+updatemons(void) {
+  Client *c;
+  Monitor *m;
+
+  if(geomstale) {
+    geomstale = false;
+    updategeom();
+  }
+  for(m = mons; m && !m->dirty; m = m->next);
+  if(!m)
+    return;
+  updatebars();
+  for(m = mons; m; m = m->next) {
+    /* the old off-screen position may be on screen now */
+    for(c = m->clients; c; c = c->next)
+      if(c->ishidden && !hideunmap)
+	sendgeom(c, c->x + 2 * SW(c->mon->scr), c->y);
+    if(!m->dirty)
+      continue;
+    m->dirty = false;
+    uint32_t geometry[] = {m->wx, m->by, m->ww, bh};
+    xcb_configure_window(xcb_dpy, m->barwin, XCB_CONFIG_MOVERESIZE, geometry);
+    arrange(m);
+  }
+}
+
 void
 updatenumlockmask(void) {
   unsigned int i, j;
@@ -2110,7 +4215,7 @@ updatenumlockmask(void) {
 
   numlockmask = 0;
   cookie = xcb_get_modifier_mapping(xcb_dpy);
-  reply = xcb_get_modifier_mapping_reply(xcb_dpy, cookie, &xerr);
+  reply = REPLY(xcb_get_modifier_mapping_reply, xcb_dpy, cookie, &xerr);
   if (xerr) xcb_error_print();
   assert(reply);
   xcb_keycode_t *modmap = xcb_get_modifier_mapping_keycodes(reply);
@@ -2128,66 +4233,107 @@ void
 updatesizehints(Client *c) {
   xcb_get_property_cookie_t cookie;
   xcb_size_hints_t size;
+  Hints *h = &c->hints;
   cookie = xcb_get_wm_normal_hints_unchecked(xcb_dpy, c->win);
 
-  if(!xcb_get_wm_normal_hints_reply(xcb_dpy, cookie, &size, NULL))
+  if(!REPLYOK(xcb_get_wm_normal_hints_reply, xcb_dpy, cookie, &size, NULL))
     /* size is uninitialized, ensure that size.flags aren't used */
     size.flags = XCB_SIZE_HINT_P_SIZE;
   if(size.flags & XCB_SIZE_HINT_BASE_SIZE) {
-    c->basew = size.base_width;
-    c->baseh = size.base_height;
+    h->basew = size.base_width;
+    h->baseh = size.base_height;
   }
   else if(size.flags & XCB_SIZE_HINT_P_MIN_SIZE) {
-    c->basew = size.min_width;
-    c->baseh = size.min_height;
+    h->basew = size.min_width;
+    h->baseh = size.min_height;
   }
   else
-    c->basew = c->baseh = 0;
+    h->basew = h->baseh = 0;
   if(size.flags & XCB_SIZE_HINT_P_RESIZE_INC) {
-    c->incw = size.width_inc;
-    c->inch = size.height_inc;
+    h->incw = size.width_inc;
+    h->inch = size.height_inc;
   }
   else
-    c->incw = c->inch = 0;
+    h->incw = h->inch = 0;
   if(size.flags & XCB_SIZE_HINT_P_MAX_SIZE) {
-    c->maxw = size.max_width;
-    c->maxh = size.max_height;
+    h->maxw = size.max_width;
+    h->maxh = size.max_height;
   }
   else
-    c->maxw = c->maxh = 0;
+    h->maxw = h->maxh = 0;
   if(size.flags & XCB_SIZE_HINT_P_MIN_SIZE) {
-    c->minw = size.min_width;
-    c->minh = size.min_height;
+    h->minw = size.min_width;
+    h->minh = size.min_height;
   }
   else if(size.flags & XCB_SIZE_HINT_BASE_SIZE) {
-    c->minw = size.base_width;
-    c->minh = size.base_height;
+    h->minw = size.base_width;
+    h->minh = size.base_height;
   }
   else
-    c->minw = c->minh = 0;
+    h->minw = h->minh = 0;
   if(size.flags & XCB_SIZE_HINT_P_ASPECT) {
-    c->mina = (float)size.min_aspect_num / size.min_aspect_den;
-    c->maxa = (float)size.max_aspect_num / size.max_aspect_den;
+    h->mina = (float)size.min_aspect_num / size.min_aspect_den;
+    h->maxa = (float)size.max_aspect_num / size.max_aspect_den;
   }
   else
-    c->maxa = c->mina = 0.0;
-  c->isfixed = (c->maxw && c->minw && c->maxh && c->minh
-		&& c->maxw == c->minw && c->maxh == c->minh);
+    h->maxa = h->mina = 0.0;
+  c->isfixed = (h->maxw && h->minw && h->maxh && h->minh
+		&& h->maxw == h->minw && h->maxh == h->minh);
 }
 
 void
 updatetitle(Client *c) {
+  char *p;
+
   if(!gettextprop(c->win, netatom[NetWMName], c->name, sizeof c->name))
     gettextprop(c->win, XCB_ATOM_WM_NAME, c->name, sizeof c->name);
   if(c->name[0] == '\0') /* hack to mark broken clients */
     strcpy(c->name, broken);
+  /* control characters would break the IPC lines, see ipcprintf() */
+  for(p = c->name; *p; p++)
+    if((unsigned char)*p < ' ' || *p == 0x7f)
+      *p = ' ';
+  c->titledirty = false;
+  c->titletime = now();
+  if(c->mon && c == c->mon->sel)
+    notify(1 << SubTitle);
+}
+
+/* Fetches pending titles of selected clients, at most once per titledelay
+ * per client, so that title storms cost one round-trip pair per interval.
+ * Titles of unselected clients stay dirty until they get selected.
+ * The next throttled title is fetched from the timer. */
+void
+updatetitles(void) {
+  uint64_t t = 0, due, next = 0;
+  Client *c;
+  Monitor *m;
+
+  for(m = mons; m; m = m->next) {
+    if(!(c = m->sel) || !c->titledirty)
+      continue;
+    if(!t)
+      t = now();
+    if(t - c->titletime >= titledelay * 1000ULL) {
+      updatetitle(c);
+      drawbar(m);
+    }
+    else {
+      due = c->titletime + titledelay * 1000ULL;
+      if(!next || due < next)
+	next = due;
+    }
+  }
+  settimer(updatetitles, next);
 }
 
 void
 updatestatus(void) {
-  if(!gettextprop(root, XCB_ATOM_WM_NAME, stext, sizeof(stext)))
-    strcpy(stext, "dwm-"VERSION);
-  drawbar(selmon);
+  char text[sizeof stext];
+
+  if(!gettextprop(screens[defscreen].root, XCB_ATOM_WM_NAME, text, sizeof text))
+    strcpy(text, hasmodules ? "" : "dwm-"VERSION);
+  setstatus(text);
 }
 
 void
@@ -2196,7 +4342,7 @@ updatewmhints(Client *c) {
   xcb_wm_hints_t hints;
 
   cookie = xcb_get_wm_hints(xcb_dpy, c->win);
-  xcb_get_wm_hints_reply(xcb_dpy, cookie, &hints, &xerr);
+  REPLYOK(xcb_get_wm_hints_reply, xcb_dpy, cookie, &hints, &xerr);
   if (xerr) {
     xcb_error_print(); return; }
   else {
@@ -2204,8 +4350,10 @@ updatewmhints(Client *c) {
       hints.flags &= ~XCB_WM_HINT_X_URGENCY;
       xcb_set_wm_hints(xcb_dpy, c->win, &hints);
     }
-    else
-      c->isurgent = (hints.flags & XCB_WM_HINT_X_URGENCY) ? true : false;
+    else if(c->isurgent != !!(hints.flags & XCB_WM_HINT_X_URGENCY)) {
+      c->isurgent = !c->isurgent;
+      notify(1 << SubTags);
+    }
   }
 }
 
@@ -2238,6 +4386,30 @@ viewnext(const Arg *arg) {
   arrange(selmon);
 }
 
+/* Has run() call func when fd is ready for events (POLLIN, POLLOUT);
+ * updates the events of an fd already watched. */
+void
+watchfd(int fd, short events, void (*func)(int fd, short revents)) {
+  struct epoll_event ee;
+  unsigned int i;
+
+  for(i = 0; i < nwatches && watches[i].fd != fd; i++);
+  if(i < nwatches && watches[i].events == events && watches[i].func == func)
+    return;
+  if(i == LENGTH(watches))
+    die("fatal: more than %u watched fds\n", (unsigned int)LENGTH(watches));
+  memset(&ee, 0, sizeof ee);
+  ee.events = (events & POLLIN ? EPOLLIN : 0) | (events & POLLOUT ? EPOLLOUT : 0);
+  ee.data.fd = fd;
+  if(epoll_ctl(epfd, i == nwatches ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ee) == -1)
+    die("dwm: cannot watch fd %d\n", fd);
+  if(i == nwatches)
+    nwatches++;
+  watches[i].fd = fd;
+  watches[i].events = events;
+  watches[i].func = func;
+}
+
 Client *
 wintoclient(xcb_window_t w) {
   Client *c;
@@ -2255,9 +4427,10 @@ wintomon(xcb_window_t w) {
   int16_t x, y;
   Client *c;
   Monitor *m;
+  Screen *s;
 
-  if(w == root && getrootptr(&x, &y))
-    return ptrtomon(x, y);
+  if((s = roottoscreen(w)) && getrootptr(w, &x, &y))
+    return ptrtomon(s, x, y);
   for(m = mons; m; m = m->next)
     if(w == m->barwin)
       return m;
@@ -2323,19 +4496,38 @@ zoom(const Arg *arg) {
 
 int
 main(int argc, char *argv[]) {
-  if(argc == 2 && !strcmp("-v", argv[1]))
-    die("dwm-"VERSION", © 2006-2009 dwm engineers, see LICENSE for details\n");
-  else if(argc != 1)
-    die("usage: dwm [-v]\n");
+  int i;
+
+  for(i = 1; i < argc; i++) {
+    if(!strcmp("-v", argv[i]))
+      die("dwm-"VERSION", © 2006-2009 dwm engineers, see LICENSE for details\n");
+    else if(!strcmp("-t", argv[i]))
+      countreqs = true;
+    else if(!strcmp("-r", argv[i]) && i + 1 < argc && !recfile) {
+      TraceHeader h;
+
+      memset(&h, 0, sizeof h);
+      memcpy(h.magic, RECORDMAGIC, sizeof h.magic);
+      h.version = TRACEVERSION;
+      if(!(recfile = fopen(argv[++i], "wb")) || fwrite(&h, sizeof h, 1, recfile) != 1)
+	die("dwm: cannot write %s\n", argv[i]);
+      fcntl(fileno(recfile), F_SETFD, FD_CLOEXEC);
+      recstart = now();
+    }
+    else
+      die("usage: dwm [-v] [-t] [-r file]\n");
+  }
   if(!setlocale(LC_CTYPE, "")) // || !XSupportsLocale())
     fputs("warning: no locale support\n", stderr);
   // if(!(dpy = XOpenDisplay(NULL)))
   //   die("dwm: cannot open display\n");
-  xcb_dpy = xcb_connect(NULL,0);
+  xcb_dpy = xcb_connect(NULL, &defscreen);
   if(xcb_connection_has_error(xcb_dpy))
     die("dwm: cannot open XCB connection to display\n");
+  fcntl(xcb_get_file_descriptor(xcb_dpy), F_SETFD, FD_CLOEXEC);
   setup();
-  scan();
+  for(i = 0; i < nscreens; i++)
+    scan(screens[i].root);
   run();
   cleanup();
   // XCloseDisplay(dpy);
@@ -0,0 +1,499 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dwmbench is a load generator for dwm.  It maps windows on an empty
+ * display, starts dwm on them and then times how fast dwm gets through a
+ * series of scenarios driven through the X server: managing new windows,
+ * title changes, ConfigureRequest floods, tag switches typed through XTEST,
+ * mouse drags and unmanaging windows.  The events and requests dwm handled
+ * in each phase are taken from the event trace dwm dumps on SIGUSR2, see
+ * trace.h; dwm is started with -t so that the trace counts requests.
+ *
+ * Whenever a phase has no reply of its own to wait for, dwmbench maps a
+ * marker window: dwm handles events in order, so once the marker is
+ * mapped everything sent before it has been processed.
+ *
+ * It is meant to be run by bench.sh against a private Xvfb server.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <X11/keysym.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_keysyms.h>
+#include <xcb/xtest.h>
+
+#include "trace.h"
+
+/* macros */
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+#define TIMEOUT                 5000 /* ms to wait for dwm */
+
+#define true 1
+#define false 0
+
+/* enums */
+enum { PhStartup, PhManage, PhTitle, PhConfigure, PhView, PhDrag, PhUnmap, PhLast };
+
+typedef struct {
+  const char *name;
+  uint64_t start, end;          /* monotonic us, as in the trace */
+  unsigned int ops;
+  unsigned long events, requests, roundtrips;
+} Phase;
+
+/* function declarations */
+static void begin(int ph);
+static int cmp64(const void *a, const void *b);
+static void die(const char *errstr, ...);
+static void drain(void);
+static void end(int ph, unsigned int ops);
+static void key(xcb_keysym_t mod, xcb_keysym_t sym);
+static xcb_keycode_t keycode(xcb_keysym_t sym);
+static xcb_window_t mkwin(int map);
+static xcb_generic_event_t *nextevent(void);
+static uint64_t now(void);
+static void printlat(const char *name, uint64_t *l, unsigned int n);
+static void readtrace(int ph);
+static void report(void);
+static void sleepms(unsigned int ms);
+static void waitmapped(xcb_window_t w);
+static void waitview(int hide);
+static void waitwithdrawn(xcb_window_t w);
+
+/* variables */
+static Phase phases[] = {
+  [PhStartup]   = { "startup" },
+  [PhManage]    = { "manage" },
+  [PhTitle]     = { "title" },
+  [PhConfigure] = { "configure" },
+  [PhView]      = { "view" },
+  [PhDrag]      = { "drag" },
+  [PhUnmap]     = { "unmap" },
+};
+static xcb_connection_t *c;
+static xcb_screen_t *screen;
+static xcb_key_symbols_t *keysyms;
+static xcb_atom_t wmstate;
+static xcb_window_t *wins;
+static unsigned int nwins, nstart = 100, nrepeat = 20;
+static uint64_t *lat, *ulat;  /* manage and unmanage latencies */
+static pid_t dwmpid = 0;
+static const char *tracefile = "/tmp/dwm.trace";
+
+/* function implementations */
+void
+begin(int ph) {
+  phases[ph].start = now();
+}
+
+int
+cmp64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+void
+die(const char *errstr, ...) {
+  va_list ap;
+
+  va_start(ap, errstr);
+  vfprintf(stderr, errstr, ap);
+  va_end(ap);
+  if(dwmpid > 0)
+    kill(dwmpid, SIGTERM);
+  exit(EXIT_FAILURE);
+}
+
+/* Maps a marker window and waits until dwm has managed it. */
+void
+drain(void) {
+  xcb_window_t w = mkwin(true);
+
+  waitmapped(w);
+  xcb_destroy_window(c, w);
+}
+
+void
+end(int ph, unsigned int ops) {
+  phases[ph].end = now();
+  phases[ph].ops = ops;
+}
+
+void
+key(xcb_keysym_t mod, xcb_keysym_t sym) {
+  xcb_keycode_t m = keycode(mod), k = keycode(sym);
+
+  xcb_test_fake_input(c, XCB_KEY_PRESS, m, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  xcb_test_fake_input(c, XCB_KEY_PRESS, k, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  xcb_test_fake_input(c, XCB_KEY_RELEASE, k, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  xcb_test_fake_input(c, XCB_KEY_RELEASE, m, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  xcb_flush(c);
+}
+
+xcb_keycode_t
+keycode(xcb_keysym_t sym) {
+  xcb_keycode_t *codes, k;
+
+  if(!(codes = xcb_key_symbols_get_keycode(keysyms, sym)))
+    die("dwmbench: no keycode for keysym 0x%x\n", sym);
+  k = codes[0];
+  free(codes);
+  return k;
+}
+
+xcb_window_t
+mkwin(int map) {
+  uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
+  xcb_window_t w = xcb_generate_id(c);
+
+  xcb_create_window(c, XCB_COPY_FROM_PARENT, w, screen->root, 10, 10, 200, 150, 0,
+		    XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+		    XCB_CW_EVENT_MASK, &mask);
+  xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, XCB_ATOM_WM_NAME,
+		      XCB_ATOM_STRING, 8, strlen("dwmbench"), "dwmbench");
+  if(map)
+    xcb_map_window(c, w);
+  xcb_flush(c);
+  return w;
+}
+
+xcb_generic_event_t *
+nextevent(void) {
+  xcb_generic_event_t *e;
+  struct pollfd pfd;
+
+  pfd.fd = xcb_get_file_descriptor(c);
+  pfd.events = POLLIN;
+  while(!(e = xcb_poll_for_event(c))) {
+    if(xcb_connection_has_error(c))
+      die("dwmbench: X connection lost\n");
+    xcb_flush(c);
+    if(poll(&pfd, 1, TIMEOUT) == 0)
+      die("dwmbench: timed out waiting for dwm\n");
+  }
+  return e;
+}
+
+uint64_t
+now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void
+printlat(const char *name, uint64_t *l, unsigned int n) {
+  qsort(l, n, sizeof *l, cmp64);
+  printf("%s latency us: min %llu, median %llu, p95 %llu, max %llu\n", name,
+	 (unsigned long long)l[0], (unsigned long long)l[n / 2],
+	 (unsigned long long)l[n * 95 / 100], (unsigned long long)l[n - 1]);
+}
+
+/* Has dwm dump its event trace and charges the entries to phase ph.  It
+ * is called after each phase, as the trace ring cannot hold all of them;
+ * a full ring that starts after the phase began means it wrapped.  dwm
+ * renames the dump into place, so once the file exists it is complete. */
+void
+readtrace(int ph) {
+  TraceHeader h;
+  TraceEntry e;
+  char path[256];
+  unsigned int i;
+  FILE *f = NULL;
+
+  snprintf(path, sizeof path, "%s.%d", tracefile, (int)dwmpid);
+  unlink(path);
+  kill(dwmpid, SIGUSR2);
+  for(i = 0; !(f = fopen(path, "rb")) && i < TIMEOUT / 10; i++)
+    sleepms(10);
+  if(!f || fread(&h, sizeof h, 1, f) != 1
+     || memcmp(h.magic, TRACEMAGIC, sizeof h.magic) || h.version != TRACEVERSION) {
+    fprintf(stderr, "dwmbench: no usable trace in %s, request counts omitted\n", path);
+    if(f)
+      fclose(f);
+    return;
+  }
+  for(i = 0; i < h.count && fread(&e, sizeof e, 1, f) == 1; i++) {
+    if(i == 0 && e.time > phases[ph].start && h.count == TRACELEN)
+      fprintf(stderr, "dwmbench: trace ring wrapped in the %s phase, its counts are low\n",
+	      phases[ph].name);
+    if(e.time >= phases[ph].start && e.time <= phases[ph].end) {
+      phases[ph].events++;
+      phases[ph].requests += e.requests;
+      phases[ph].roundtrips += e.roundtrips;
+    }
+  }
+  fclose(f);
+  unlink(path);
+}
+
+void
+report(void) {
+  unsigned int i;
+  Phase *p;
+
+  printf("dwmbench: %u windows at startup, %u repeats\n", nstart, nrepeat);
+  printf("%-10s %6s %10s %9s %7s %8s %7s\n",
+	 "phase", "ops", "total ms", "us/op", "events", "req/op", "rt/op");
+  for(i = 0; i < PhLast; i++) {
+    p = &phases[i];
+    if(!p->ops)
+      continue;
+    printf("%-10s %6u %10.3f %9.1f %7lu %8.2f %7.2f\n", p->name, p->ops,
+	   (p->end - p->start) / 1000.0, (double)(p->end - p->start) / p->ops,
+	   p->events, (double)p->requests / p->ops, (double)p->roundtrips / p->ops);
+  }
+  printlat("manage", lat, nrepeat);
+  printlat("unmap", ulat, nrepeat);
+}
+
+void
+sleepms(unsigned int ms) {
+  struct timespec ts;
+
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000;
+  while(nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+void
+waitmapped(xcb_window_t w) {
+  xcb_generic_event_t *e;
+  int done = false;
+
+  while(!done) {
+    e = nextevent();
+    done = (e->response_type & 0x7f) == XCB_MAP_NOTIFY
+      && ((xcb_map_notify_event_t *)e)->window == w;
+    free(e);
+  }
+}
+
+/* Waits until dwm hid (or showed) all managed windows, by unmapping them
+ * or moving them off-screen depending on its hideunmap setting. */
+void
+waitview(int hide) {
+  static char *done = NULL;
+  xcb_generic_event_t *e;
+  xcb_window_t w;
+  unsigned int i, n = 0;
+  int h;
+
+  if(!(done = realloc(done, nwins)))
+    die("dwmbench: out of memory\n");
+  memset(done, 0, nwins);
+  while(n < nwins) {
+    e = nextevent();
+    switch(e->response_type & 0x7f) {
+    case XCB_MAP_NOTIFY:
+      w = ((xcb_map_notify_event_t *)e)->window;
+      h = false;
+      break;
+    case XCB_UNMAP_NOTIFY:
+      w = ((xcb_unmap_notify_event_t *)e)->window;
+      h = true;
+      break;
+    case XCB_CONFIGURE_NOTIFY:
+      w = ((xcb_configure_notify_event_t *)e)->window;
+      h = ((xcb_configure_notify_event_t *)e)->x >= screen->width_in_pixels;
+      break;
+    default:
+      w = XCB_NONE;
+      h = !hide;
+    }
+    free(e);
+    if(h != hide)
+      continue;
+    for(i = 0; i < nwins && wins[i] != w; i++);
+    if(i < nwins && !done[i]) {
+      done[i] = true;
+      n++;
+    }
+  }
+}
+
+/* Waits until dwm has unmanaged w, which it withdraws through WM_STATE. */
+void
+waitwithdrawn(xcb_window_t w) {
+  xcb_generic_event_t *e;
+  int done = false;
+
+  while(!done) {
+    e = nextevent();
+    done = (e->response_type & 0x7f) == XCB_PROPERTY_NOTIFY
+      && ((xcb_property_notify_event_t *)e)->window == w
+      && ((xcb_property_notify_event_t *)e)->atom == wmstate;
+    free(e);
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  xcb_intern_atom_reply_t *ar;
+  xcb_get_geometry_reply_t *geo;
+  xcb_generic_event_t *e;
+  xcb_window_t w;
+  char buf[32], *seen;
+  unsigned int i, n;
+  int16_t x, y;
+  uint64_t t;
+
+  for(i = 1; i < argc - 1 && argv[i][0] == '-'; i += 2) {
+    if(!strcmp(argv[i], "-n"))
+      nstart = atoi(argv[i + 1]);
+    else if(!strcmp(argv[i], "-r"))
+      nrepeat = atoi(argv[i + 1]);
+    else if(!strcmp(argv[i], "-t"))
+      tracefile = argv[i + 1];
+    else
+      break;
+  }
+  if(i != argc - 1 || !nrepeat)
+    die("usage: dwmbench [-n windows] [-r repeats] [-t tracefile] dwm\n");
+  /* the server may still be starting */
+  for(t = now(); ; sleepms(20)) {
+    c = xcb_connect(NULL, NULL);
+    if(!xcb_connection_has_error(c))
+      break;
+    xcb_disconnect(c);
+    if(now() - t > TIMEOUT * 1000)
+      die("dwmbench: cannot open display\n");
+  }
+  screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+  keysyms = xcb_key_symbols_alloc(c);
+  ar = xcb_intern_atom_reply(c, xcb_intern_atom(c, 0, strlen("WM_STATE"), "WM_STATE"), NULL);
+  if(!ar)
+    die("dwmbench: cannot intern WM_STATE\n");
+  wmstate = ar->atom;
+  free(ar);
+  if(!(wins = malloc((nstart + nrepeat) * sizeof *wins)) || !(lat = malloc(nrepeat * sizeof *lat))
+     || !(ulat = malloc(nrepeat * sizeof *ulat))
+     || !(seen = calloc(nstart + 1, 1)))
+    die("dwmbench: out of memory\n");
+
+  /* startup: dwm scans and manages the windows already mapped */
+  for(nwins = 0; nwins < nstart; nwins++)
+    wins[nwins] = mkwin(true);
+  free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+  begin(PhStartup);
+  if((dwmpid = fork()) == 0) {
+    close(xcb_get_file_descriptor(c));
+    execl(argv[argc - 1], argv[argc - 1], "-t", (char *)NULL);
+    fprintf(stderr, "dwmbench: execl %s failed\n", argv[argc - 1]);
+    _exit(EXIT_FAILURE);
+  }
+  if(dwmpid < 0)
+    die("dwmbench: fork failed\n");
+  for(n = 0; n < nstart; ) {
+    e = nextevent();
+    if((e->response_type & 0x7f) == XCB_PROPERTY_NOTIFY
+       && ((xcb_property_notify_event_t *)e)->atom == wmstate) {
+      /* count each window once, dwm may set the state again */
+      for(i = 0; i < nstart && wins[i] != ((xcb_property_notify_event_t *)e)->window; i++);
+      if(i < nstart && !seen[i]) {
+	seen[i] = true;
+	n++;
+      }
+    }
+    free(e);
+  }
+  free(seen);
+  end(PhStartup, nstart);
+  readtrace(PhStartup);
+
+  /* manage: map windows one at a time */
+  begin(PhManage);
+  for(i = 0; i < nrepeat; i++) {
+    t = now();
+    wins[nwins++] = w = mkwin(true);
+    waitmapped(w);
+    lat[i] = now() - t;
+  }
+  end(PhManage, nrepeat);
+  readtrace(PhManage);
+
+  /* title: the focused window renames itself */
+  w = wins[nwins - 1];
+  begin(PhTitle);
+  for(i = 0; i < 50 * nrepeat; i++) {
+    n = snprintf(buf, sizeof buf, "dwmbench %u", i);
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, XCB_ATOM_WM_NAME,
+			XCB_ATOM_STRING, 8, n, buf);
+  }
+  drain();
+  end(PhTitle, 50 * nrepeat);
+  readtrace(PhTitle);
+
+  /* configure: a tiled window asks for geometries it won't get */
+  w = wins[0];
+  begin(PhConfigure);
+  for(i = 0; i < 10 * nrepeat; i++) {
+    uint32_t v[] = { i % 100, i % 50, 100 + i % 200, 100 + i % 150 };
+    xcb_configure_window(c, w, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y
+			 | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, v);
+  }
+  drain();
+  end(PhConfigure, 10 * nrepeat);
+  readtrace(PhConfigure);
+
+  /* view: switch to an empty tag and back */
+  begin(PhView);
+  for(i = 0; i < nrepeat; i++) {
+    key(XK_Alt_L, XK_2);
+    waitview(true);
+    key(XK_Alt_L, XK_1);
+    waitview(false);
+  }
+  end(PhView, 2 * nrepeat);
+  readtrace(PhView);
+
+  /* drag: move the focused window with Mod1+Button1 */
+  w = wins[nwins - 1];
+  if(!(geo = xcb_get_geometry_reply(c, xcb_get_geometry(c, w), NULL)))
+    die("dwmbench: cannot get window geometry\n");
+  x = geo->x + geo->width / 2;
+  y = geo->y + geo->height / 2;
+  free(geo);
+  begin(PhDrag);
+  xcb_test_fake_input(c, XCB_MOTION_NOTIFY, false, XCB_CURRENT_TIME, screen->root, x, y, 0);
+  xcb_test_fake_input(c, XCB_KEY_PRESS, keycode(XK_Alt_L), XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  xcb_test_fake_input(c, XCB_BUTTON_PRESS, 1, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  for(i = 0; i < 10 * nrepeat; i++)
+    xcb_test_fake_input(c, XCB_MOTION_NOTIFY, false, XCB_CURRENT_TIME, screen->root,
+			x + i % 300, y + i % 200, 0);
+  xcb_test_fake_input(c, XCB_BUTTON_RELEASE, 1, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  xcb_test_fake_input(c, XCB_KEY_RELEASE, keycode(XK_Alt_L), XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  drain();
+  end(PhDrag, 10 * nrepeat);
+  readtrace(PhDrag);
+
+  /* unmap: the windows of the manage phase withdraw one at a time */
+  begin(PhUnmap);
+  for(i = 0; i < nrepeat; i++) {
+    t = now();
+    w = wins[--nwins];
+    xcb_unmap_window(c, w);
+    xcb_flush(c);
+    waitwithdrawn(w);
+    ulat[i] = now() - t;
+  }
+  end(PhUnmap, nrepeat);
+  readtrace(PhUnmap);
+
+  report();
+  kill(dwmpid, SIGTERM);
+  waitpid(dwmpid, NULL, 0);
+  xcb_key_symbols_free(keysyms);
+  xcb_disconnect(c);
+  return 0;
+}
@@ -0,0 +1,55 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dwmc sends one request to the dwm IPC socket named by DWM_SOCKET and
+ * prints the answer, e.g. dwmc view 2 or dwmc clients.  See dwm(1).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static void
+die(const char *errstr) {
+  fputs(errstr, stderr);
+  exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[]) {
+  struct sockaddr_un sa;
+  char buf[4096], tail[3] = "";
+  const char *path = getenv("DWM_SOCKET");
+  size_t len = 0;
+  ssize_t n;
+  int i, fd;
+
+  if(argc < 2 || argc > 3)
+    die("usage: dwmc command [argument]\n");
+  if(!path)
+    die("dwmc: DWM_SOCKET is not set\n");
+  for(i = 1; i < argc; i++)
+    len += snprintf(buf + len, sizeof buf - len, "%s%s", argv[i], i + 1 < argc ? " " : "\n");
+  if(len >= sizeof buf)
+    die("dwmc: request too long\n");
+  memset(&sa, 0, sizeof sa);
+  sa.sun_family = AF_UNIX;
+  strncpy(sa.sun_path, path, sizeof sa.sun_path - 1);
+  if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1
+     || connect(fd, (struct sockaddr *)&sa, sizeof sa) == -1)
+    die("dwmc: cannot connect to dwm\n");
+  if(write(fd, buf, len) != len)
+    die("dwmc: cannot send request\n");
+  shutdown(fd, SHUT_WR);
+  while((n = read(fd, buf, sizeof buf)) > 0) {
+    fwrite(buf, 1, n, stdout);
+    /* the answer ends in ok or an error line */
+    for(i = 0; i < n; i++) {
+      memmove(tail, tail + 1, 2);
+      tail[2] = buf[i];
+    }
+  }
+  close(fd);
+  return memcmp(tail, "ok\n", 3) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
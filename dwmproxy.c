@@ -0,0 +1,320 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dwmproxy sits between one X client and the server and counts what goes
+ * over the wire: requests by major opcode, request bytes, replies, events
+ * and errors.  It listens on the local socket of a display of its own and
+ * forwards to the local socket of the real one, e.g.
+ *
+ *   dwmproxy -b 5000 -R 200 :98 :99 &
+ *   DISPLAY=:98 dwm &
+ *   DISPLAY=:99 dwmreplay -f session.rec
+ *
+ * The tally is printed when the client disconnects or dwmproxy receives
+ * SIGINT or SIGTERM.  NoOperation requests, which dwm -t sends to count
+ * the requests of each event, are listed but left out of the request
+ * total.  -b and -R set budgets for requests and replies; if
+ * either is exceeded dwmproxy exits with status 2, so a replayed session
+ * doubles as a regression check on dwm's protocol traffic.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* macros */
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+#define PAD(N)                  (((N) + 3) & ~3UL)
+#define SOCKDIR                 "/tmp/.X11-unix/X"
+
+#define true 1
+#define false 0
+
+typedef struct {
+  int server;                   /* parses server to client traffic */
+  int setup;                    /* still in connection setup */
+  uint8_t hdr[8];
+  unsigned int hlen;
+  unsigned long skip;           /* bytes left of the current message */
+} Stream;
+
+/* function declarations */
+static uint32_t card16(const uint8_t *p);
+static uint32_t card32(const uint8_t *p);
+static void die(const char *errstr, ...);
+static int forward(int from, int to, Stream *s);
+static unsigned int need(Stream *s);
+static void parse(Stream *s, const uint8_t *buf, size_t n);
+static void report(void);
+static void sighandler(int sig);
+static void sockpath(struct sockaddr_un *sa, const char *display);
+static void take(Stream *s);
+
+/* variables */
+static const char *names[128] = {
+  [1] = "CreateWindow", "ChangeWindowAttributes", "GetWindowAttributes",
+  "DestroyWindow", "DestroySubwindows", "ChangeSaveSet", "ReparentWindow",
+  "MapWindow", "MapSubwindows", "UnmapWindow", "UnmapSubwindows",
+  "ConfigureWindow", "CirculateWindow", "GetGeometry", "QueryTree",
+  "InternAtom", "GetAtomName", "ChangeProperty", "DeleteProperty",
+  "GetProperty", "ListProperties", "SetSelectionOwner", "GetSelectionOwner",
+  "ConvertSelection", "SendEvent", "GrabPointer", "UngrabPointer",
+  "GrabButton", "UngrabButton", "ChangeActivePointerGrab", "GrabKeyboard",
+  "UngrabKeyboard", "GrabKey", "UngrabKey", "AllowEvents", "GrabServer",
+  "UngrabServer", "QueryPointer", "GetMotionEvents", "TranslateCoordinates",
+  "WarpPointer", "SetInputFocus", "GetInputFocus", "QueryKeymap", "OpenFont",
+  "CloseFont", "QueryFont", "QueryTextExtents", "ListFonts",
+  "ListFontsWithInfo", "SetFontPath", "GetFontPath", "CreatePixmap",
+  "FreePixmap", "CreateGC", "ChangeGC", "CopyGC", "SetDashes",
+  "SetClipRectangles", "FreeGC", "ClearArea", "CopyArea", "CopyPlane",
+  "PolyPoint", "PolyLine", "PolySegment", "PolyRectangle", "PolyArc",
+  "FillPoly", "PolyFillRectangle", "PolyFillArc", "PutImage", "GetImage",
+  "PolyText8", "PolyText16", "ImageText8", "ImageText16", "CreateColormap",
+  "FreeColormap", "CopyColormapAndFree", "InstallColormap",
+  "UninstallColormap", "ListInstalledColormaps", "AllocColor",
+  "AllocNamedColor", "AllocColorCells", "AllocColorPlanes", "FreeColors",
+  "StoreColors", "StoreNamedColor", "QueryColors", "LookupColor",
+  "CreateCursor", "CreateGlyphCursor", "FreeCursor", "RecolorCursor",
+  "QueryBestSize", "QueryExtension", "ListExtensions",
+  "ChangeKeyboardMapping", "GetKeyboardMapping", "ChangeKeyboardControl",
+  "GetKeyboardControl", "Bell", "ChangePointerControl", "GetPointerControl",
+  "SetScreenSaver", "GetScreenSaver", "ChangeHosts", "ListHosts",
+  "SetAccessControl", "SetCloseDownMode", "KillClient", "RotateProperties",
+  "ForceScreenSaver", "SetPointerMapping", "GetPointerMapping",
+  "SetModifierMapping", "GetModifierMapping", [127] = "NoOperation",
+};
+static unsigned long opcount[256];
+static unsigned long requests, reqbytes, replies, events, errors;
+static int bigendian = false;
+static volatile sig_atomic_t running = true;
+
+/* function implementations */
+uint32_t
+card16(const uint8_t *p) {
+  return bigendian ? p[0] << 8 | p[1] : p[1] << 8 | p[0];
+}
+
+uint32_t
+card32(const uint8_t *p) {
+  return bigendian ? card16(p) << 16 | card16(p + 2) : card16(p + 2) << 16 | card16(p);
+}
+
+void
+die(const char *errstr, ...) {
+  va_list ap;
+
+  va_start(ap, errstr);
+  vfprintf(stderr, errstr, ap);
+  va_end(ap);
+  exit(EXIT_FAILURE);
+}
+
+/* Copies what is readable on from to to, returns false at end of file. */
+int
+forward(int from, int to, Stream *s) {
+  uint8_t buf[65536];
+  ssize_t n, w, off;
+
+  if((n = read(from, buf, sizeof buf)) <= 0)
+    return n < 0 && errno == EINTR;
+  parse(s, buf, n);
+  for(off = 0; off < n; off += w)
+    if((w = write(to, buf + off, n - off)) < 0) {
+      if(errno != EINTR)
+	return false;
+      w = 0;
+    }
+  return true;
+}
+
+/* Header bytes needed to know the length of the current message. */
+unsigned int
+need(Stream *s) {
+  if(s->setup)
+    return s->server ? 8 : 12;
+  if(s->server) /* replies and GenericEvents carry an extra length */
+    return s->hlen && ((s->hdr[0] & 0x7f) == 1 || (s->hdr[0] & 0x7f) == 35) ? 8 : 1;
+  /* a request length of 0 means BIG-REQUESTS, the real one follows */
+  return s->hlen >= 4 && !card16(s->hdr + 2) ? 8 : 4;
+}
+
+void
+parse(Stream *s, const uint8_t *buf, size_t n) {
+  size_t len;
+
+  while(n) {
+    if(s->skip) {
+      len = s->skip < n ? s->skip : n;
+      s->skip -= len;
+      buf += len;
+      n -= len;
+      continue;
+    }
+    while(n && s->hlen < need(s)) {
+      s->hdr[s->hlen++] = *buf++;
+      n--;
+    }
+    if(s->hlen == need(s))
+      take(s);
+  }
+}
+
+void
+report(void) {
+  unsigned int i, j, order[256];
+
+  printf("dwmproxy: %lu requests, %lu bytes, %lu replies, %lu events, %lu errors\n",
+	 requests, reqbytes, replies, events, errors);
+  for(i = 0; i < LENGTH(order); i++)
+    order[i] = i;
+  /* few distinct opcodes, insertion sort by count will do */
+  for(i = 1; i < LENGTH(order); i++)
+    for(j = i; j > 0 && opcount[order[j]] > opcount[order[j - 1]]; j--) {
+      order[j] ^= order[j - 1];
+      order[j - 1] ^= order[j];
+      order[j] ^= order[j - 1];
+    }
+  for(i = 0; i < LENGTH(order) && opcount[order[i]]; i++) {
+    j = order[i];
+    if(j < LENGTH(names) && names[j])
+      printf("%10lu %s\n", opcount[j], names[j]);
+    else
+      printf("%10lu %s %u\n", opcount[j], j < 128 ? "opcode" : "extension", j);
+  }
+  fflush(stdout);
+}
+
+void
+sighandler(int sig) {
+  running = false;
+}
+
+void
+sockpath(struct sockaddr_un *sa, const char *display) {
+  const char *p = strchr(display, ':');
+  size_t n;
+
+  if(!p || !(n = strspn(p + 1, "0123456789")))
+    die("dwmproxy: bad display %s\n", display);
+  memset(sa, 0, sizeof *sa);
+  sa->sun_family = AF_UNIX;
+  snprintf(sa->sun_path, sizeof sa->sun_path, SOCKDIR "%.*s", (int)n, p + 1);
+}
+
+/* Accounts the message whose header is complete. */
+void
+take(Stream *s) {
+  unsigned long len;
+
+  if(s->setup) {
+    if(s->server)
+      len = 8 + card16(s->hdr + 6) * 4;
+    else {
+      bigendian = s->hdr[0] == 'B';
+      len = 12 + PAD(card16(s->hdr + 6)) + PAD(card16(s->hdr + 8));
+    }
+    s->setup = false;
+  }
+  else if(s->server) {
+    switch(s->hdr[0] & 0x7f) {
+    case 0:
+      errors++;
+      len = 32;
+      break;
+    case 1:
+      replies++;
+      len = 32 + card32(s->hdr + 4) * 4;
+      break;
+    case 35:
+      events++;
+      len = 32 + card32(s->hdr + 4) * 4;
+      break;
+    default:
+      events++;
+      len = 32;
+    }
+  }
+  else {
+    len = card16(s->hdr + 2) * 4;
+    if(s->hlen == 8)
+      len = card32(s->hdr + 4) * 4;
+    if(len < s->hlen)
+      die("dwmproxy: malformed request\n");
+    opcount[s->hdr[0]]++;
+    if(s->hdr[0] != 127) { /* NoOperation */
+      requests++;
+      reqbytes += len;
+    }
+  }
+  s->skip = len - s->hlen;
+  s->hlen = 0;
+}
+
+int
+main(int argc, char *argv[]) {
+  struct sockaddr_un local, upstream;
+  struct pollfd pfd[2];
+  Stream cs = { false, true }, ss = { true, true };
+  unsigned long budget = 0, rtbudget = 0;
+  int i, ls, cfd, sfd, over;
+
+  for(i = 1; i < argc - 2 && argv[i][0] == '-'; i += 2) {
+    if(!strcmp(argv[i], "-b"))
+      budget = strtoul(argv[i + 1], NULL, 10);
+    else if(!strcmp(argv[i], "-R"))
+      rtbudget = strtoul(argv[i + 1], NULL, 10);
+    else
+      break;
+  }
+  if(i != argc - 2)
+    die("usage: dwmproxy [-b requests] [-R replies] listen-display server-display\n");
+  sockpath(&local, argv[i]);
+  sockpath(&upstream, argv[i + 1]);
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, sighandler);
+  signal(SIGTERM, sighandler);
+
+  if((ls = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    die("dwmproxy: cannot create socket\n");
+  unlink(local.sun_path);
+  if(bind(ls, (struct sockaddr *)&local, sizeof local) < 0 || listen(ls, 1) < 0)
+    die("dwmproxy: cannot listen on %s\n", local.sun_path);
+  while((cfd = accept(ls, NULL, NULL)) < 0)
+    if(errno != EINTR || !running) {
+      unlink(local.sun_path);
+      die("dwmproxy: no client\n");
+    }
+  close(ls);
+  unlink(local.sun_path);
+  if((sfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+     || connect(sfd, (struct sockaddr *)&upstream, sizeof upstream) < 0)
+    die("dwmproxy: cannot connect to %s\n", upstream.sun_path);
+
+  pfd[0].fd = cfd;
+  pfd[1].fd = sfd;
+  pfd[0].events = pfd[1].events = POLLIN;
+  while(running) {
+    if(poll(pfd, LENGTH(pfd), -1) < 0) {
+      if(errno == EINTR)
+	continue;
+      die("dwmproxy: poll failed\n");
+    }
+    if(pfd[0].revents & (POLLIN | POLLHUP | POLLERR) && !forward(cfd, sfd, &cs))
+      break;
+    if(pfd[1].revents & (POLLIN | POLLHUP | POLLERR) && !forward(sfd, cfd, &ss))
+      break;
+  }
+  close(cfd);
+  close(sfd);
+  report();
+  over = (budget && requests > budget) || (rtbudget && replies > rtbudget);
+  if(over)
+    fprintf(stderr, "dwmproxy: over budget\n");
+  return over ? 2 : 0;
+}
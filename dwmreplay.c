@@ -0,0 +1,377 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dwmreplay plays an event recording made with dwm -r back against the X
+ * server in DISPLAY, on which a dwm under test should be running.  It does
+ * not resend the recorded events; it redoes what caused them, so the dwm
+ * under test sees the same sequence again:
+ *
+ * - CreateNotify creates a window of the recorded geometry,
+ * - MapRequest maps it, DestroyNotify destroys it,
+ * - ConfigureRequest issues the same ConfigureWindow,
+ * - PropertyNotify on a client rewrites the property: WM_NAME gets a
+ *   numbered title, other predefined atoms are zero-filled,
+ * - PropertyNotify of WM_NAME on the root window sets a new status text,
+ * - key, button and motion events and EnterNotify are faked through XTEST.
+ *
+ * Everything the server generates on its own, like Expose, MapNotify or
+ * ConfigureNotify, follows from the above and is skipped, as are
+ * synthetic events.  Key codes are replayed as recorded, so the keymap of
+ * both servers should be the same; bench.sh's Xvfb will do.
+ *
+ * The recorded timing is kept unless -f is given, in which case the
+ * recording is replayed as fast as the server takes it.
+ *
+ * With -w, dwmreplay waits for the window manager before and after the
+ * replay with a marker window: it maps one and waits until the window
+ * manager set its WM_STATE, then unmaps it and waits for WM_STATE again.
+ * dwm handles events in order, so at the end everything the replay caused
+ * has been handled; at the start dwm manages the marker in its initial
+ * scan if it was not running yet.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xcb.h>
+#include <xcb/xtest.h>
+
+#include "trace.h"
+
+#define TIMEOUT                 5000 /* ms to wait for the window manager */
+
+#define true 1
+#define false 0
+
+typedef struct {
+  xcb_window_t rec, win;        /* window in the recording, replayed window */
+} Win;
+
+/* function declarations */
+static void configure(xcb_configure_request_event_t *e);
+static void create(xcb_window_t rec, int16_t x, int16_t y, uint16_t w, uint16_t h,
+		   uint16_t bw, int override);
+static void die(const char *errstr, ...);
+static void fake(uint8_t type, uint8_t detail, int16_t x, int16_t y);
+static Win *lookup(xcb_window_t rec);
+static void marker(void);
+static uint64_t now(void);
+static void property(xcb_property_notify_event_t *e);
+static void replay(const uint8_t *ev);
+static void sleepus(uint64_t us);
+static void waitstate(xcb_window_t w);
+
+/* variables */
+static xcb_connection_t *c;
+static xcb_screen_t *screen;
+static Win *wins;
+static unsigned int nwins, maxwins;
+static unsigned long titles, skipped;
+static xcb_atom_t wmstate;
+
+/* function implementations */
+void
+configure(xcb_configure_request_event_t *e) {
+  uint32_t values[7];
+  uint16_t mask = 0;
+  unsigned int n = 0;
+  Win *s;
+
+  if(!lookup(e->window))
+    create(e->window, e->x, e->y, e->width, e->height, e->border_width, false);
+  if(e->value_mask & XCB_CONFIG_WINDOW_X) {
+    mask |= XCB_CONFIG_WINDOW_X;
+    values[n++] = e->x;
+  }
+  if(e->value_mask & XCB_CONFIG_WINDOW_Y) {
+    mask |= XCB_CONFIG_WINDOW_Y;
+    values[n++] = e->y;
+  }
+  if(e->value_mask & XCB_CONFIG_WINDOW_WIDTH) {
+    mask |= XCB_CONFIG_WINDOW_WIDTH;
+    values[n++] = e->width;
+  }
+  if(e->value_mask & XCB_CONFIG_WINDOW_HEIGHT) {
+    mask |= XCB_CONFIG_WINDOW_HEIGHT;
+    values[n++] = e->height;
+  }
+  if(e->value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH) {
+    mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH;
+    values[n++] = e->border_width;
+  }
+  /* a sibling we never saw cannot be named, stack without it */
+  if(e->value_mask & XCB_CONFIG_WINDOW_SIBLING && (s = lookup(e->sibling))) {
+    mask |= XCB_CONFIG_WINDOW_SIBLING;
+    values[n++] = s->win;
+  }
+  if(e->value_mask & XCB_CONFIG_WINDOW_STACK_MODE) {
+    mask |= XCB_CONFIG_WINDOW_STACK_MODE;
+    values[n++] = e->stack_mode;
+  }
+  xcb_configure_window(c, lookup(e->window)->win, mask, values);
+}
+
+void
+create(xcb_window_t rec, int16_t x, int16_t y, uint16_t w, uint16_t h,
+       uint16_t bw, int override) {
+  uint32_t values[2];
+  Win *p;
+
+  if(nwins == maxwins) {
+    maxwins = maxwins ? maxwins * 2 : 64;
+    if(!(wins = realloc(wins, maxwins * sizeof *wins)))
+      die("dwmreplay: out of memory\n");
+  }
+  p = &wins[nwins++];
+  p->rec = rec;
+  p->win = xcb_generate_id(c);
+  values[0] = override;
+  values[1] = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+  xcb_create_window(c, XCB_COPY_FROM_PARENT, p->win, screen->root, x, y,
+		    w ? w : 1, h ? h : 1, bw, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+		    screen->root_visual, XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK,
+		    values);
+}
+
+void
+die(const char *errstr, ...) {
+  va_list ap;
+
+  va_start(ap, errstr);
+  vfprintf(stderr, errstr, ap);
+  va_end(ap);
+  exit(EXIT_FAILURE);
+}
+
+void
+fake(uint8_t type, uint8_t detail, int16_t x, int16_t y) {
+  xcb_test_fake_input(c, XCB_MOTION_NOTIFY, false, XCB_CURRENT_TIME,
+		      screen->root, x, y, 0);
+  if(type != XCB_MOTION_NOTIFY)
+    xcb_test_fake_input(c, type, detail, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+}
+
+Win *
+lookup(xcb_window_t rec) {
+  unsigned int i;
+
+  for(i = nwins; i > 0; i--)
+    if(wins[i - 1].rec == rec)
+      return &wins[i - 1];
+  return NULL;
+}
+
+/* Round trip through the window manager, see -w above. */
+void
+marker(void) {
+  uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+  xcb_window_t w = xcb_generate_id(c);
+
+  xcb_create_window(c, XCB_COPY_FROM_PARENT, w, screen->root, 0, 0, 100, 100, 0,
+		    XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+		    XCB_CW_EVENT_MASK, &mask);
+  xcb_map_window(c, w);
+  waitstate(w);
+  xcb_unmap_window(c, w);
+  waitstate(w);
+  xcb_destroy_window(c, w);
+  xcb_flush(c);
+}
+
+uint64_t
+now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void
+property(xcb_property_notify_event_t *e) {
+  static const uint32_t zero[18];
+  char buf[32];
+  xcb_window_t w;
+  Win *p;
+
+  if(e->window == screen->root)
+    w = screen->root;
+  else if((p = lookup(e->window)))
+    w = p->win;
+  else {
+    skipped++;
+    return;
+  }
+  if(e->state == XCB_PROPERTY_DELETE)
+    xcb_delete_property(c, w, e->atom);
+  else if(e->atom == XCB_ATOM_WM_NAME) {
+    snprintf(buf, sizeof buf, "dwmreplay %lu", ++titles);
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, XCB_ATOM_WM_NAME,
+			XCB_ATOM_STRING, 8, strlen(buf), buf);
+  }
+  else if(e->atom <= XCB_ATOM_WM_TRANSIENT_FOR && w != screen->root)
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, e->atom,
+			e->atom == XCB_ATOM_WM_NORMAL_HINTS ? XCB_ATOM_WM_SIZE_HINTS : e->atom,
+			32, sizeof zero / sizeof zero[0], zero);
+  else
+    skipped++;
+}
+
+void
+replay(const uint8_t *ev) {
+  union {
+    const uint8_t *raw;
+    xcb_create_notify_event_t *create;
+    xcb_destroy_notify_event_t *destroy;
+    xcb_map_request_event_t *map;
+    xcb_key_press_event_t *key;
+    xcb_enter_notify_event_t *enter;
+  } e;
+  Win *p;
+
+  e.raw = ev;
+  if(ev[0] & 0x80) {
+    skipped++;
+    return;
+  }
+  switch(ev[0]) {
+  case XCB_CREATE_NOTIFY:
+    if(e.create->parent == e.create->window || lookup(e.create->window))
+      break;
+    create(e.create->window, e.create->x, e.create->y, e.create->width,
+	   e.create->height, e.create->border_width, e.create->override_redirect);
+    break;
+  case XCB_DESTROY_NOTIFY:
+    if((p = lookup(e.destroy->window))) {
+      xcb_destroy_window(c, p->win);
+      p->rec = XCB_NONE;
+    }
+    break;
+  case XCB_MAP_REQUEST:
+    if(!(p = lookup(e.map->window))) {
+      create(e.map->window, 0, 0, 200, 150, 0, false);
+      p = lookup(e.map->window);
+    }
+    xcb_map_window(c, p->win);
+    break;
+  case XCB_CONFIGURE_REQUEST:
+    configure((xcb_configure_request_event_t *)ev);
+    break;
+  case XCB_PROPERTY_NOTIFY:
+    property((xcb_property_notify_event_t *)ev);
+    break;
+  case XCB_KEY_PRESS:
+  case XCB_KEY_RELEASE:
+  case XCB_BUTTON_PRESS:
+  case XCB_BUTTON_RELEASE:
+  case XCB_MOTION_NOTIFY:
+    /* all of them share the layout of KeyPress */
+    fake(ev[0], e.key->detail, e.key->root_x, e.key->root_y);
+    break;
+  case XCB_ENTER_NOTIFY:
+    if(e.enter->mode == XCB_NOTIFY_MODE_NORMAL)
+      fake(XCB_MOTION_NOTIFY, 0, e.enter->root_x, e.enter->root_y);
+    break;
+  default:
+    skipped++;
+  }
+}
+
+void
+sleepus(uint64_t us) {
+  struct timespec ts;
+
+  ts.tv_sec = us / 1000000;
+  ts.tv_nsec = (us % 1000000) * 1000;
+  while(nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+/* Waits for a change of WM_STATE on w; other events are dropped. */
+void
+waitstate(xcb_window_t w) {
+  xcb_generic_event_t *e;
+  struct pollfd pfd;
+  int done = false;
+
+  xcb_flush(c);
+  pfd.fd = xcb_get_file_descriptor(c);
+  pfd.events = POLLIN;
+  while(!done) {
+    while(!(e = xcb_poll_for_event(c))) {
+      if(xcb_connection_has_error(c))
+	die("dwmreplay: X connection lost\n");
+      if(poll(&pfd, 1, TIMEOUT) == 0)
+	die("dwmreplay: timed out waiting for the window manager\n");
+    }
+    done = (e->response_type & 0x7f) == XCB_PROPERTY_NOTIFY
+      && ((xcb_property_notify_event_t *)e)->window == w
+      && ((xcb_property_notify_event_t *)e)->atom == wmstate;
+    free(e);
+  }
+}
+
+int
+main(int argc, char *argv[]) {
+  xcb_get_input_focus_reply_t *r;
+  xcb_intern_atom_reply_t *ar;
+  TraceHeader h;
+  RecordEntry re;
+  unsigned long n = 0;
+  uint64_t start, t;
+  int fast = false, wait = false, i;
+  FILE *f;
+
+  for(i = 1; i < argc - 1; i++) {
+    if(!strcmp(argv[i], "-f"))
+      fast = true;
+    else if(!strcmp(argv[i], "-w"))
+      wait = true;
+    else
+      break;
+  }
+  if(i != argc - 1)
+    die("usage: dwmreplay [-f] [-w] file\n");
+  if(!(f = fopen(argv[argc - 1], "rb")))
+    die("dwmreplay: cannot open %s\n", argv[argc - 1]);
+  if(fread(&h, sizeof h, 1, f) != 1 || memcmp(h.magic, RECORDMAGIC, sizeof h.magic))
+    die("dwmreplay: not a dwm recording\n");
+  if(h.version != TRACEVERSION)
+    die("dwmreplay: unsupported recording version\n");
+  c = xcb_connect(NULL, NULL);
+  if(xcb_connection_has_error(c))
+    die("dwmreplay: cannot open display\n");
+  if(!xcb_get_extension_data(c, &xcb_test_id)->present)
+    die("dwmreplay: the server lacks XTEST\n");
+  screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+  if(wait) {
+    ar = xcb_intern_atom_reply(c, xcb_intern_atom(c, 0, strlen("WM_STATE"), "WM_STATE"), NULL);
+    if(!ar)
+      die("dwmreplay: cannot intern WM_STATE\n");
+    wmstate = ar->atom;
+    free(ar);
+    marker();
+  }
+  start = now();
+  while(fread(&re, sizeof re, 1, f) == 1) {
+    if(!fast && (t = now() - start) < re.time) {
+      xcb_flush(c);
+      sleepus(re.time - t);
+    }
+    replay(re.event);
+    n++;
+  }
+  fclose(f);
+  /* wait for the server, or the window manager, to have taken everything */
+  if(wait)
+    marker();
+  else if((r = xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL)))
+    free(r);
+  if(xcb_connection_has_error(c))
+    die("dwmreplay: X connection lost\n");
+  printf("dwmreplay: %lu events in %.3f ms, %lu skipped\n",
+	 n, (now() - start) / 1000.0, skipped);
+  xcb_disconnect(c);
+  return 0;
+}
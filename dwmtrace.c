@@ -0,0 +1,69 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dwmtrace prints an event trace dumped by dwm on SIGUSR2, one event per
+ * line: time since the first event, event type, window, handler time,
+ * replies waited for, requests issued and flushes.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+static const char *names[] = {
+  "Error", "Reply", "KeyPress", "KeyRelease", "ButtonPress", "ButtonRelease",
+  "MotionNotify", "EnterNotify", "LeaveNotify", "FocusIn", "FocusOut",
+  "KeymapNotify", "Expose", "GraphicsExpose", "NoExposure",
+  "VisibilityNotify", "CreateNotify", "DestroyNotify", "UnmapNotify",
+  "MapNotify", "MapRequest", "ReparentNotify", "ConfigureNotify",
+  "ConfigureRequest", "GravityNotify", "ResizeRequest", "CirculateNotify",
+  "CirculateRequest", "PropertyNotify", "SelectionClear",
+  "SelectionRequest", "SelectionNotify", "ColormapNotify", "ClientMessage",
+  "MappingNotify",
+};
+
+static void
+die(const char *errstr) {
+  fputs(errstr, stderr);
+  exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[]) {
+  TraceHeader h;
+  TraceEntry e;
+  uint64_t start = 0;
+  uint32_t i;
+  char buf[16];
+  const char *name;
+  FILE *f;
+
+  if(argc != 2)
+    die("usage: dwmtrace file\n");
+  if(!(f = fopen(argv[1], "rb")))
+    die("dwmtrace: cannot open trace file\n");
+  if(fread(&h, sizeof h, 1, f) != 1 || memcmp(h.magic, TRACEMAGIC, sizeof h.magic))
+    die("dwmtrace: not a dwm trace\n");
+  if(h.version != TRACEVERSION)
+    die("dwmtrace: unsupported trace version\n");
+  printf("%12s %-18s %10s %8s %4s %5s %3s\n",
+	 "ms", "event", "window", "us", "rt", "req", "fl");
+  for(i = 0; i < h.count; i++) {
+    if(fread(&e, sizeof e, 1, f) != 1)
+      die("dwmtrace: truncated trace\n");
+    if(!i)
+      start = e.time;
+    if(e.type < sizeof names / sizeof names[0])
+      name = names[e.type];
+    else {
+      snprintf(buf, sizeof buf, "event %u", e.type);
+      name = buf;
+    }
+    printf("%12.3f %-18s 0x%08x %8u %4u %5u %3u\n",
+	   (e.time - start) / 1000.0, name, (unsigned int)e.window,
+	   (unsigned int)e.duration, e.roundtrips, e.requests, e.flushes);
+  }
+  fclose(f);
+  return 0;
+}
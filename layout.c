@@ -0,0 +1,117 @@
+/* See LICENSE file for copyright and license details. */
+#include <math.h>
+#include <stdint.h>
+
+#include "layout.h"
+
+/* macros */
+#define MAX(A, B)               ((A) > (B) ? (A) : (B))
+#define MIN(A, B)               ((A) < (B) ? (A) : (B))
+
+/* Geometry as dwm's resize() would leave it, hints applied. */
+static void
+place(Geom *g, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t minsize, int usehints) {
+  g->r.x = x;
+  g->r.y = y;
+  g->r.w = MAX(1, w);
+  g->r.h = MAX(1, h);
+  layouthints(&g->r, g->hints, minsize, usehints);
+}
+
+void
+layoutclamp(Rect *r, const Rect *cur, uint16_t bw, const Rect *area) {
+  /* set minimum possible */
+  r->w = MAX(1, r->w);
+  r->h = MAX(1, r->h);
+  if(r->x > area->x + area->w)
+    r->x = area->x + area->w - (cur->w + 2 * bw);
+  if(r->y > area->y + area->h)
+    r->y = area->y + area->h - (cur->h + 2 * bw);
+  if(r->x + r->w + 2 * bw < area->x)
+    r->x = area->x;
+  if(r->y + r->h + 2 * bw < area->y)
+    r->y = area->y;
+}
+
+void
+layouthints(Rect *r, const Hints *h, uint16_t minsize, int usehints) {
+  int w = MAX(r->w, minsize), hh = MAX(r->h, minsize), baseismin;
+
+  if(usehints && h) {
+    /* see last two sentences in ICCCM 4.1.2.3 */
+    baseismin = h->basew == h->minw && h->baseh == h->minh;
+    if(!baseismin) { /* temporarily remove base dimensions */
+      w -= h->basew;
+      hh -= h->baseh;
+    }
+    /* adjust for aspect limits */
+    if(h->mina > 0 && h->maxa > 0) {
+      if(h->maxa < (float)w / hh)
+	w = lroundf(hh * h->maxa);
+      else if(h->mina < (float)hh / w)
+	hh = lroundf(w * h->mina);
+    }
+    if(baseismin) { /* increment calculation requires this */
+      w -= h->basew;
+      hh -= h->baseh;
+    }
+    /* adjust for increment value */
+    if(h->incw)
+      w -= w % h->incw;
+    if(h->inch)
+      hh -= hh % h->inch;
+    /* restore base dimensions */
+    w += h->basew;
+    hh += h->baseh;
+    w = MAX(w, h->minw);
+    hh = MAX(hh, h->minh);
+    if(h->maxw)
+      w = MIN(w, h->maxw);
+    if(h->maxh)
+      hh = MIN(hh, h->maxh);
+  }
+  r->w = w;
+  r->h = hh;
+}
+
+void
+layoutmonocle(const Rect *area, uint16_t minsize, int usehints,
+	      Geom *g, unsigned int n) {
+  unsigned int i;
+
+  for(i = 0; i < n; i++)
+    place(&g[i], area->x, area->y, area->w - 2 * g[i].bw, area->h - 2 * g[i].bw,
+	  minsize, usehints);
+}
+
+void
+layouttile(const Rect *area, float mfact, uint16_t minsize, int usehints,
+	   Geom *g, unsigned int n) {
+  int16_t x, y;
+  uint16_t h, w, mw;
+  unsigned int i;
+  Rect *r;
+
+  if(n == 0)
+    return;
+  /* master */
+  mw = lroundf(mfact * area->w);
+  place(&g[0], area->x, area->y, (n == 1 ? area->w : mw) - 2 * g[0].bw,
+	area->h - 2 * g[0].bw, minsize, usehints);
+  if(--n == 0)
+    return;
+  /* tile stack */
+  r = &g[0].r;
+  x = (area->x + mw > r->x + r->w) ? r->x + r->w + 2 * g[0].bw : area->x + mw;
+  y = area->y;
+  w = (area->x + mw > r->x + r->w) ? area->x + area->w - x : area->w - mw;
+  h = area->h / n;
+  if(h < minsize)
+    h = area->h;
+  for(i = 0, g++; i < n; i++, g++) {
+    place(g, x, y, w - 2 * g->bw, /* remainder */ ((i + 1 == n)
+		  ? area->y + area->h - y - 2 * g->bw : h - 2 * g->bw), minsize, usehints);
+    if(h != area->h)
+      y = g->r.y + g->r.h + 2 * g->bw;
+  }
+}
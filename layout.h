@@ -0,0 +1,35 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Geometry of the layouts, kept free of X and of dwm's state so that it can
+ * be timed on its own, see layoutbench.c.  All functions work on plain
+ * rectangles: the caller passes the area to fill and one Geom per tiled
+ * client, in stacking order, and gets the outer-border-less geometries
+ * back in Geom.r.
+ */
+typedef struct {
+  int16_t x, y;
+  uint16_t w, h;
+} Rect;
+
+typedef struct {
+  float mina, maxa;
+  int32_t basew, baseh, incw, inch, maxw, maxh, minw, minh;
+} Hints;                        /* ICCCM WM_NORMAL_HINTS, 0 if unset */
+
+typedef struct {
+  const Hints *hints;
+  uint16_t bw;                  /* border width */
+  Rect r;                       /* result */
+} Geom;
+
+/* Keeps r at least partly within area, moving it by its current size cur. */
+void layoutclamp(Rect *r, const Rect *cur, uint16_t bw, const Rect *area);
+/* Makes r at least minsize square and, if usehints, honours the hints. */
+void layouthints(Rect *r, const Hints *h, uint16_t minsize, int usehints);
+/* Every client fills the area. */
+void layoutmonocle(const Rect *area, uint16_t minsize, int usehints,
+		   Geom *g, unsigned int n);
+/* The first client takes mfact of the area, the others share the rest in
+ * a column.  Rows lower than minsize make the column overlap. */
+void layouttile(const Rect *area, float mfact, uint16_t minsize, int usehints,
+		Geom *g, unsigned int n);
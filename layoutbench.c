@@ -0,0 +1,127 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * layoutbench times the layout functions of layout.c without an X server,
+ * for 1 to 10000 tiled clients.  Every other client carries terminal-like
+ * size hints (base size and resize increments), every fifth an aspect
+ * range, so that the hint code is exercised as dwm would.
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "layout.h"
+
+/* macros */
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+#define MINTIME                 200000 /* us to spend on each measurement */
+
+#define true 1
+#define false 0
+
+/* function declarations */
+static void die(const char *errstr);
+static uint64_t now(void);
+static void setup(unsigned int n);
+static double timeit(int kernel, unsigned int n);
+
+/* variables */
+static const char *kernels[] = { "tile", "monocle", "hints" };
+static const unsigned int sizes[] = { 1, 10, 100, 1000, 10000 };
+static const Rect area = { 0, 18, 1920, 1182 };
+static Hints *hints;
+static Geom *geoms;
+static unsigned long sink;
+
+/* function implementations */
+void
+die(const char *errstr) {
+  fputs(errstr, stderr);
+  exit(EXIT_FAILURE);
+}
+
+uint64_t
+now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void
+setup(unsigned int n) {
+  unsigned int i;
+
+  if(!(hints = calloc(n, sizeof *hints)) || !(geoms = calloc(n, sizeof *geoms)))
+    die("layoutbench: out of memory\n");
+  for(i = 0; i < n; i++) {
+    if(i % 2) {
+      hints[i].basew = hints[i].minw = 4;
+      hints[i].baseh = hints[i].minh = 4;
+      hints[i].incw = 7;
+      hints[i].inch = 14;
+    }
+    if(i % 5 == 0) {
+      hints[i].mina = 0.5f;
+      hints[i].maxa = 2.0f;
+    }
+    geoms[i].hints = &hints[i];
+    geoms[i].bw = 1;
+  }
+}
+
+/* Returns the mean time of one call of the kernel in ns. */
+double
+timeit(int kernel, unsigned int n) {
+  unsigned long calls = 0;
+  unsigned int i;
+  uint64_t start, t;
+  Rect r;
+
+  start = now();
+  do {
+    switch(kernel) {
+    case 0:
+      layouttile(&area, 0.55f, 18, true, geoms, n);
+      break;
+    case 1:
+      layoutmonocle(&area, 18, true, geoms, n);
+      break;
+    case 2:
+      for(i = 0; i < n; i++) {
+	r.x = r.y = 0;
+	r.w = 400 + i % 300;
+	r.h = 300 + i % 200;
+	layouthints(&r, &hints[i], 18, true);
+	sink += r.w;
+      }
+      break;
+    }
+    sink += geoms[n - 1].r.w;
+    calls++;
+  } while((t = now() - start) < MINTIME);
+  return t * 1000.0 / calls;
+}
+
+int
+main(int argc, char *argv[]) {
+  unsigned int i, k, max = sizes[LENGTH(sizes) - 1];
+  double ns;
+
+  if(argc == 3 && !strcmp(argv[1], "-n"))
+    max = strtoul(argv[2], NULL, 10);
+  else if(argc != 1)
+    die("usage: layoutbench [-n maxclients]\n");
+  setup(max);
+  printf("%-8s %8s %14s %12s\n", "kernel", "clients", "ns/call", "ns/client");
+  for(k = 0; k < LENGTH(kernels); k++)
+    for(i = 0; i < LENGTH(sizes) && sizes[i] <= max; i++) {
+      ns = timeit(k, sizes[i]);
+      printf("%-8s %8u %14.1f %12.2f\n", kernels[k], sizes[i], ns, ns / sizes[i]);
+    }
+  free(hints);
+  free(geoms);
+  return sink == 42; /* keep the results alive */
+}
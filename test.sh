@@ -0,0 +1,42 @@
+#!/bin/sh
+# See LICENSE file for copyright and license details.
+#
+# Replays test.rec against the dwm in this directory, which talks to a
+# private Xvfb through dwmproxy, and fails if dwm sends more requests or
+# waits for more replies than budgeted.  test.rec maps six windows,
+# retitles one 20 times, sends 20 ConfigureRequests, switches between
+# tags 1 and 2 five times with Mod1 and destroys the windows again.
+#
+# TESTDISPLAY picks the display number of Xvfb, dwm uses the next one.
+# REQUESTS and REPLIES override the budgets.
+n=${TESTDISPLAY:-97}
+requests=${REQUESTS:-4000}
+replies=${REPLIES:-400}
+
+# waits up to 5 s for the local socket of display :$1
+waitdisplay() {
+	i=0
+	while [ ! -S /tmp/.X11-unix/X$1 ]; do
+		if [ $i -ge 50 ]; then
+			echo "test.sh: display :$1 did not come up" >&2
+			exit 1
+		fi
+		i=$((i + 1))
+		sleep 0.1
+	done
+}
+
+Xvfb :$n -screen 0 1280x1024x24 -nolisten tcp >/dev/null 2>&1 &
+xvfb=$!
+trap 'kill $xvfb $proxy $dwm 2>/dev/null' EXIT INT TERM
+waitdisplay $n
+./dwmproxy -b $requests -R $replies :$((n + 1)) :$n &
+proxy=$!
+waitdisplay $((n + 1))
+DISPLAY=:$((n + 1)) ./dwm &
+dwm=$!
+# -w waits until dwm manages a marker window before and after the replay
+DISPLAY=:$n ./dwmreplay -f -w test.rec || exit 1
+# dwm exits cleanly on SIGTERM, dwmproxy then reports and checks the budgets
+kill $dwm
+wait $proxy
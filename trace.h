@@ -0,0 +1,39 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Event trace file, written by dwm on SIGUSR2 and read by dwmtrace.  The
+ * file is a TraceHeader followed by count TraceEntry records, oldest
+ * first.  Both are in host byte order, so a trace is decoded on the
+ * machine which wrote it; a foreign byte order shows as a bad version.
+ *
+ * Event recordings, written by dwm -r and read by dwmreplay, use the same
+ * header with RECORDMAGIC and a count of 0, followed by RecordEntry
+ * records up to the end of the file.
+ */
+#include <stdint.h>
+
+#define TRACEMAGIC              "dwmtrace"
+#define RECORDMAGIC             "dwmrecrd"
+#define TRACEVERSION            1
+#define TRACELEN                16384 /* events kept in dwm's trace ring */
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+} TraceHeader;
+
+typedef struct {
+  uint64_t time;                /* dispatch time, monotonic us */
+  uint32_t window;              /* window the event is about, 0 if none */
+  uint32_t duration;            /* handler time in us */
+  uint16_t requests;            /* requests issued by the handler, 0 without dwm -t */
+  uint8_t type;                 /* response type, 0 for errors */
+  uint8_t roundtrips;           /* replies waited for */
+  uint8_t flushes;
+  uint8_t pad[3];
+} TraceEntry;
+
+typedef struct {
+  uint64_t time;                /* us since the recording started */
+  uint8_t event[32];            /* the event as read from the server */
+} RecordEntry;